@@ -1,3 +1,5 @@
+#include "nodeLock.hpp"
+#include "sha256.hpp"
 #include <atomic>
 #include <bitset>
 #include <chrono>
@@ -6,11 +8,11 @@
 #include <cstdlib>
 #include <iostream>
 #include <mutex>
-#include <openssl/sha.h>
 #include <queue>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -51,9 +53,13 @@ struct ThreadUpdateId {
     }
 };
 
-// Structure for MerkleTree nodes
+// Structure for MerkleTree nodes. Writers take node_mutex exclusively; with
+// a SeqLock, readers only check its sequence number and retry.
+template <typename Lock = mutex>
 struct MerkleNode {
-    string hash;
+    using LockType = Lock;
+
+    Digest hash;
     MerkleNode *left;
     MerkleNode *right;
     MerkleNode *parent;
@@ -61,13 +67,12 @@ struct MerkleNode {
     ThreadUpdateId left_child_thread_index;
     ThreadUpdateId right_child_thread_index;
     bool is_leaf;
-    mutex node_mutex;
-    string key;
+    Lock node_mutex;
 
     MerkleNode(bool leaf = false)
         : hash(), left(nullptr), right(nullptr), parent(nullptr),
           last_updated_thread_index(), left_child_thread_index(), right_child_thread_index(),
-          is_leaf(leaf), key("") {}
+          is_leaf(leaf) {}
 
     ~MerkleNode() {
         delete left;
@@ -75,29 +80,18 @@ struct MerkleNode {
     }
 };
 
-// Hash function using SHA256
-string computeHash(const string &data) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char *>(data.c_str()), data.length(), hash);
-    string result;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
-        char buf[3];
-        snprintf(buf, sizeof(buf), "%02x", hash[i]);
-        result += buf;
-    }
-    return result;
-}
-
+template <typename Lock = mutex>
 class SparseMerkleTree {
 private:
-    MerkleNode *root;
+    using Node = MerkleNode<Lock>;
+
+    Node *root;
     int depth;
-    const string default_leaf_hash = computeHash("");
-    unordered_map<string, MerkleNode *> leaf_nodes;
+    const Digest default_leaf_hash = computeHash("");
+    unordered_map<string, Node *> leaf_nodes;
 
-    MerkleNode *buildCompleteTree(int current_depth, MerkleNode *parent = nullptr, string current_path = "") {
-        MerkleNode *node = new MerkleNode(current_depth == 0);
-        node->key = current_path;
+    Node *buildCompleteTree(int current_depth, Node *parent = nullptr, string current_path = "") {
+        Node *node = new Node(current_depth == 0);
         node->parent = parent;
 
         if (current_depth == 0) {
@@ -107,9 +101,7 @@ private:
         } else {
             node->left = buildCompleteTree(current_depth - 1, node, current_path + "0");
             node->right = buildCompleteTree(current_depth - 1, node, current_path + "1");
-            string left_hash = node->left->hash;
-            string right_hash = node->right->hash;
-            node->hash = computeHash(left_hash + right_hash);
+            node->hash = hashChildren(node->left->hash, node->right->hash);
         }
         return node;
     }
@@ -131,10 +123,10 @@ public:
     }
 
     string getRootHash() const {
-        return root->hash;
+        return root->hash.toHex();
     }
 
-    MerkleNode *getLeafNode(const string &key) {
+    Node *getLeafNode(const string &key) {
         auto it = leaf_nodes.find(key);
         if (it != leaf_nodes.end()) {
             return it->second;
@@ -158,7 +150,7 @@ public:
             throw runtime_error("Invalid key length");
         }
 
-        MerkleNode *current = nullptr;
+        Node *current = nullptr;
         {
             auto it = leaf_nodes.find(key);
             if (it == leaf_nodes.end()) {
@@ -168,7 +160,7 @@ public:
         }
 
         {
-            lock_guard<mutex> lock(current->node_mutex);
+            lock_guard<Lock> lock(current->node_mutex);
             if (!current->is_leaf) {
                 throw runtime_error("Reached non-leaf node");
             }
@@ -193,11 +185,11 @@ public:
             // }
 
             int isLeft = -1;
-            string leftHash = "", rightHash = "";
-            MerkleNode *parent = current->parent;
-            MerkleNode *left = NULL, *right = NULL;
+            Digest leftHash, rightHash;
+            Node *parent = current->parent;
+            Node *left = NULL, *right = NULL;
             ThreadUpdateId left_updated_by, right_updated_by;
-            lock_guard<mutex> parent_lock(parent->node_mutex);
+            lock_guard<Lock> parent_lock(parent->node_mutex);
             // Check stop condition after acquiring parent lock
             if (thread_index.thread_index >= 0 && stop_vector[thread_index.thread_index].load() >= thread_index.update_count) {
                 return;
@@ -220,8 +212,8 @@ public:
             }
 
             {
-                lock_guard<mutex> leftChildLock(left->node_mutex);
-                lock_guard<mutex> rightChildLock(right->node_mutex);
+                lock_guard<Lock> leftChildLock(left->node_mutex);
+                lock_guard<Lock> rightChildLock(right->node_mutex);
                 leftHash = left->hash;
                 left_updated_by = left->last_updated_thread_index;
                 rightHash = right->hash;
@@ -239,8 +231,7 @@ public:
                 }
             }
 
-            string parentHash = leftHash + rightHash;
-            parent->hash = computeHash(parentHash);
+            parent->hash = hashChildren(leftHash, rightHash);
             parent->left_child_thread_index = left_updated_by;
             parent->right_child_thread_index = right_updated_by;
             parent->last_updated_thread_index = thread_index;
@@ -252,7 +243,7 @@ public:
         if (key.length() != depth) {
             throw runtime_error("Invalid key length");
         }
-        MerkleNode *current = nullptr;
+        Node *current = nullptr;
         {
             auto it = leaf_nodes.find(key);
             if (it == leaf_nodes.end()) {
@@ -260,7 +251,7 @@ public:
             }
             current = it->second;
         }
-        string childHash = "";
+        Digest childHash;
         {
             if (!current->is_leaf) {
                 throw runtime_error("Reached non-leaf node");
@@ -271,9 +262,9 @@ public:
 
         while (current != root) {
             int isLeft = -1;
-            string siblingHash = "";
-            MerkleNode *parent = current->parent;
-            MerkleNode *sibling = NULL;
+            Digest siblingHash;
+            Node *parent = current->parent;
+            Node *sibling = NULL;
             if (current == parent->left) {
                 isLeft = 1;
                 sibling = parent->right;
@@ -284,31 +275,40 @@ public:
             {
                 siblingHash = sibling->hash;
             }
-            string parentHash = isLeft ? (childHash + siblingHash) : (siblingHash + childHash);
-            parent->hash = computeHash(parentHash);
+            parent->hash = isLeft ? hashChildren(childHash, siblingHash) : hashChildren(siblingHash, childHash);
             current = parent;
             childHash = current->hash;
         }
     }
 
-    string readRootHash() {
-        lock_guard<mutex> lock(root->node_mutex);
-        return root->hash;
+    // With a SeqLock, reads are lock-free: they never wait on, or delay, a
+    // percolating writer. Other locks are taken briefly.
+    static Digest readHash(Node *node) {
+        if constexpr (is_same<Lock, SeqLock>::value) {
+            return optimisticRead(node->node_mutex, node->hash);
+        } else {
+            lock_guard<Lock> lock(node->node_mutex);
+            return node->hash;
+        }
     }
 
-    string readLeafHash(const string &key) {
-        MerkleNode *leaf = getLeafNode(key);
+    Digest readRootHash() {
+        return readHash(root);
+    }
+
+    Digest readLeafHash(const string &key) {
+        Node *leaf = getLeafNode(key);
         if (!leaf)
             throw runtime_error("Leaf not found for key: " + key);
-        lock_guard<mutex> lock(leaf->node_mutex);
-        return leaf->hash;
+        return readHash(leaf);
     }
 };
 
 // Thread pool
+template <typename Lock>
 class MerkleThreadPool {
 private:
-    SparseMerkleTree &tree;
+    SparseMerkleTree<Lock> &tree;
     queue<OperationRequest> request_queue;
     mutex queue_mutex;
     condition_variable cv;
@@ -341,10 +341,10 @@ private:
                 thread_index.update_count = thread_update_counter;
                 tree.update(request.key, request.value, thread_index);
             } else if (request.op_type == READ_ROOT) {
-                string hash = tree.readRootHash();
+                Digest hash = tree.readRootHash();
                 (void)hash;
             } else if (request.op_type == READ_LEAF) {
-                string hash = tree.readLeafHash(request.key);
+                Digest hash = tree.readLeafHash(request.key);
                 (void)hash;
             }
 
@@ -365,7 +365,7 @@ private:
 public:
     vector<thread> workers;
 
-    MerkleThreadPool(SparseMerkleTree &tree, int num_threads, int total_ops)
+    MerkleThreadPool(SparseMerkleTree<Lock> &tree, int num_threads, int total_ops)
         : tree(tree), stop_threads(false), processed_ops(0), total_ops(total_ops) {
         for (int i = 0; i < num_threads; ++i)
             workers.emplace_back(&MerkleThreadPool::worker_function, this, i);
@@ -393,7 +393,8 @@ public:
     int get_processed_ops() const { return processed_ops.load(); }
 };
 
-thread_local int MerkleThreadPool::thread_update_counter = 0;
+template <typename Lock>
+thread_local int MerkleThreadPool<Lock>::thread_update_counter = 0;
 
 // Random operation generator
 OperationRequest generate_random_operation(int tree_depth, double read_percentage, const vector<string> &leaf_keys) {
@@ -414,10 +415,11 @@ OperationRequest generate_random_operation(int tree_depth, double read_percentag
     }
 }
 
-long long verify_with_serial_execution(const vector<OperationRequest> &operations, int tree_depth, SparseMerkleTree &tree) {
+template <typename Lock>
+long long verify_with_serial_execution(const vector<OperationRequest> &operations, int tree_depth, SparseMerkleTree<Lock> &tree) {
     cout << "\n==== Starting Serial Verification ====\n";
 
-    SparseMerkleTree serial_tree(tree_depth);
+    SparseMerkleTree<Lock> serial_tree(tree_depth);
     cout << "Initial root hash (serial): " << serial_tree.getRootHash() << endl;
     auto serial_start = chrono::high_resolution_clock::now();
 
@@ -425,10 +427,10 @@ long long verify_with_serial_execution(const vector<OperationRequest> &operation
         if (req.op_type == UPDATE) {
             serial_tree.updateSerial(req.key, req.value);
         } else if (req.op_type == READ_ROOT) {
-            string hash = serial_tree.readRootHash();
+            Digest hash = serial_tree.readRootHash();
             (void)hash; // simulate read
         } else if (req.op_type == READ_LEAF) {
-            string hash = serial_tree.readLeafHash(req.key);
+            Digest hash = serial_tree.readLeafHash(req.key);
             (void)hash; // simulate read
         }
     }
@@ -449,25 +451,10 @@ long long verify_with_serial_execution(const vector<OperationRequest> &operation
     return serial_duration;
 }
 
-int main() {
-    srand(time(nullptr));
-    int tree_depth, num_threads, total_ops;
-    double read_percentage;
-
-    cout << "Enter tree depth, read percentage, number of threads, and total operations: ";
-    cin >> tree_depth >> read_percentage >> num_threads >> total_ops;
-
-    if (num_threads > MAX_THREADS) {
-        cout << "Number of threads exceeds maximum limit of " << MAX_THREADS << endl;
-        return 1;
-    }
-
-    if (tree_depth < 0 || read_percentage < 0 || read_percentage > 100 || num_threads <= 0 || total_ops <= 0) {
-        cout << "Invalid input values." << endl;
-        return 1;
-    }
-
-    SparseMerkleTree tree(tree_depth);
+// One parallel run on a tree whose nodes use Lock, checked against serial
+template <typename Lock>
+int run(int tree_depth, double read_percentage, int num_threads, int total_ops) {
+    SparseMerkleTree<Lock> tree(tree_depth);
     cout << "Initial Tree State (Root Hash): " << tree.getRootHash() << endl;
     cout << "Total leaf nodes: " << tree.getLeafCount() << endl;
     cout << "------------------------" << endl;
@@ -475,7 +462,7 @@ int main() {
     // vector to store all operations
     vector<OperationRequest> all_operations;
 
-    MerkleThreadPool pool(tree, num_threads, total_ops);
+    MerkleThreadPool<Lock> pool(tree, num_threads, total_ops);
     auto start_time = chrono::high_resolution_clock::now();
 
     all_operations.reserve(total_ops);
@@ -526,4 +513,33 @@ int main() {
     cout << "------------------------" << endl;
 
     return 0;
-}
\ No newline at end of file
+}
+
+int main() {
+    srand(time(nullptr));
+    int tree_depth, num_threads, total_ops;
+    double read_percentage;
+
+    cout << "Enter tree depth, read percentage, number of threads, and total operations: ";
+    cin >> tree_depth >> read_percentage >> num_threads >> total_ops;
+
+    if (num_threads > MAX_THREADS) {
+        cout << "Number of threads exceeds maximum limit of " << MAX_THREADS << endl;
+        return 1;
+    }
+
+    if (tree_depth < 0 || read_percentage < 0 || read_percentage > 100 || num_threads <= 0 || total_ops <= 0) {
+        cout << "Invalid input values." << endl;
+        return 1;
+    }
+
+    // Spinning seqlock writers suit one thread per core; when threads
+    // outnumber cores, a preempted lock holder would leave the others
+    // spinning, so nodes fall back to a blocking mutex
+    if (num_threads <= int(thread::hardware_concurrency())) {
+        cout << "Node lock: seqlock" << endl;
+        return run<SeqLock>(tree_depth, read_percentage, num_threads, total_ops);
+    }
+    cout << "Node lock: mutex" << endl;
+    return run<mutex>(tree_depth, read_percentage, num_threads, total_ops);
+}
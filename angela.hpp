@@ -1,84 +1,115 @@
 #pragma once
 #include "merkleTree.hpp"
+#include "workerPool.hpp"
 #include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <mutex>
 #include <string>
 #include <thread>
-#include <unordered_set>
 #include <vector>
 
-struct AngelaNode : public MerkleNode {
-    atomic<int> visited;
+// Both fields hold batch stamps, so nothing needs resetting between batches:
+// conflict_batch marks a node where two paths of that batch join, and
+// visited records that the first of the two arrivals has passed.
+template <typename Lock = mutex>
+struct BasicAngelaNode : public BasicMerkleNode<Lock> {
+    uint32_t conflict_batch;
+    atomic<uint32_t> visited;
 
-    AngelaNode(bool leaf = false)
-        : MerkleNode(leaf), visited(0) {}
+    BasicAngelaNode(bool leaf = false)
+        : BasicMerkleNode<Lock>(leaf), conflict_batch(0), visited(0) {}
 };
 
+using AngelaNode = BasicAngelaNode<>;
+
 class AngelaAlgorithm {
 public:
+    AngelaAlgorithm() = default;
+
+    // Runs batches on a caller-owned pool (e.g. one shared with other
+    // algorithms); batches then use at most executor.size() threads
+    explicit AngelaAlgorithm(WorkerPool &executor) : pool(executor) {}
+
+    // Each worker claims a group of updates as wide as the hashing kernel and
+    // percolates them in lockstep, so the parents recomputed at one level are
+    // hashed together in a single multi-lane call.
     template <typename TreeType>
     static void workerFunc(
-        int tid,
         TreeType *tree,
-        vector<pair<string, string>> *updates,
-        unordered_set<string> *conflictPrefixes,
+        vector<pair<BitKey, string>> *updates,
+        vector<typename TreeType::NodeTypeAlias *> *leaves,
+        uint32_t batch,
         atomic<size_t> *taskIndex,
         size_t total) {
         using Node = typename TreeType::NodeTypeAlias;
+        using Hash = typename TreeType::Hash;
+
+        const size_t groupSize = Hash::batchWidth();
+        Node *root = tree->getRoot();
+
+        vector<Node *> active, parents;
+        vector<HashChildrenJob> jobs;
+        vector<Digest> results;
 
         while (true) {
-            size_t idx = taskIndex->fetch_add(1);
-            if (idx >= total)
+            size_t begin = taskIndex->fetch_add(groupSize);
+            if (begin >= total)
                 break;
+            size_t end = min(total, begin + groupSize);
 
-            const string &key = (*updates)[idx].first;
-            const string &val = (*updates)[idx].second;
+            // update leaves
+            active.clear();
+            for (size_t idx = begin; idx < end; ++idx) {
+                const string &val = (*updates)[idx].second;
 
-            Node *leaf = tree->getLeafNode(key);
-            if (!leaf)
-                continue;
+                Node *leaf = (*leaves)[idx];
+                if (!leaf)
+                    continue;
 
-            // update leaf
-            {
-                lock_guard<mutex> lk(leaf->node_mutex);
-                leaf->hash = computeHash(val);
+                lock_guard lk(leaf->node_mutex);
+                leaf->hash = Hash::hashLeaf(val);
+                active.push_back(leaf);
             }
 
-            // percolate upwards
-            Node *cur = leaf;
-            Node *root = tree->getRoot();
+            // percolate upwards, one level per iteration; all lanes of a group
+            // are at the same height, and a missing child (sparse mode) is an
+            // empty subtree of that height
+            for (int height = 0; !active.empty(); ++height) {
+                const Digest &emptySubtree = tree->getDefaultHash(height);
+                parents.clear();
+                for (Node *cur : active) {
+                    if (cur == root)
+                        continue;
+                    Node *parent = static_cast<Node *>(cur->parent);
+                    if (!parent)
+                        continue;
 
-            while (cur != root) {
-                Node *parent = static_cast<Node *>(cur->parent);
-                if (!parent)
-                    break;
-
-                bool isConflict = conflictPrefixes->count(parent->key);
-
-                if (isConflict) {
-                    unique_lock<mutex> pl(parent->node_mutex);
-                    int expected = 0;
-                    if (parent->visited.compare_exchange_strong(expected, 1)) {
-                        pl.unlock();
-                        break;
+                    // first arrival at a conflict node stops, the second one
+                    // sees both children final and carries on
+                    if (parent->conflict_batch == batch) {
+                        lock_guard pl(parent->node_mutex);
+                        if (parent->visited.exchange(batch) != batch)
+                            continue;
                     }
-
-                    string L = parent->left ? parent->left->hash : "";
-                    string R = parent->right ? parent->right->hash : "";
-                    parent->hash = computeHash(L + R);
-
-                    cur = parent;
-                    continue;
+                    parents.push_back(parent);
                 }
 
-                unique_lock<mutex> pl(parent->node_mutex);
-                string L = parent->left ? parent->left->hash : "";
-                string R = parent->right ? parent->right->hash : "";
-                parent->hash = computeHash(L + R);
+                jobs.clear();
+                results.resize(parents.size());
+                for (size_t i = 0; i < parents.size(); ++i) {
+                    Node *parent = parents[i];
+                    jobs.push_back({parent->left ? &parent->left->hash : &emptySubtree,
+                                    parent->right ? &parent->right->hash : &emptySubtree,
+                                    &results[i]});
+                }
+                Hash::hashChildrenBatch(jobs.data(), jobs.size());
 
-                cur = parent;
+                for (size_t i = 0; i < parents.size(); ++i) {
+                    lock_guard pl(parents[i]->node_mutex);
+                    parents[i]->hash = results[i];
+                }
+                active.swap(parents);
             }
         }
     }
@@ -89,45 +120,55 @@ public:
     template <typename TreeType>
     long long processBatch(
         TreeType &tree,
-        const vector<pair<string, string>> &updates_in,
+        const vector<pair<BitKey, string>> &updates_in,
         int numThreads) {
         using Node = typename TreeType::NodeTypeAlias;
 
-        if (updates_in.empty())
+        // -----------------------------
+        // SORT AND COALESCE BY KEY
+        // -----------------------------
+        // Only the last write to a key is applied, so duplicates cost no
+        // hashing and the root matches applying the batch in order
+        vector<pair<BitKey, string>> updates = updates_in;
+        last_coalesced = coalesceByKey(updates);
+        if (updates.empty())
             return 0;
 
         // -----------------------------
-        // SORT BY KEY
+        // LOCATE LEAVES
         // -----------------------------
-        vector<pair<string, string>> updates = updates_in;
-
-        sort(updates.begin(), updates.end(),
-             [](auto &a, auto &b) { return a.first < b.first; });
+        // Done serially so that sparse-mode path allocation never races
+        // with workers reading child pointers.
+        vector<Node *> leaves(updates.size());
+        for (size_t i = 0; i < updates.size(); ++i)
+            leaves[i] = tree.getOrCreateLeafNode(updates[i].first);
 
         // -----------------------------
-        // COMPUTE CONFLICT PREFIXES
+        // COMPUTE CONFLICT NODES
         // -----------------------------
-        unordered_set<string> conflictPrefixes;
-
-        auto lcp = [&](const string &a, const string &b) {
-            size_t n = min(a.size(), b.size());
-            size_t i = 0;
-            for (; i < n; ++i)
-                if (a[i] != b[i])
-                    break;
-            return i;
-        };
-
-        for (size_t i = 0; i + 1 < updates.size(); ++i) {
-            size_t cl = lcp(updates[i].first, updates[i + 1].first);
-            conflictPrefixes.insert(updates[i].first.substr(0, cl));
-        }
+        // Where the paths of two updates join. The located leaves are walked
+        // up one height at a time; sorted keys keep siblings adjacent, so a
+        // parent reached from two children in a row is a conflict node, and
+        // it is stamped with this batch's number
+        uint32_t batch = ++batch_counter;
+        if (batch == 0) // fresh nodes carry 0
+            batch = ++batch_counter;
 
-        // reset visited flags
-        for (auto &prefix : conflictPrefixes) {
-            Node *n = getNodeByPrefix(tree, prefix);
-            if (n)
-                n->visited.store(false);
+        Node *root = tree.getRoot();
+        vector<Node *> level, parents;
+        for (Node *leaf : leaves)
+            if (leaf)
+                level.push_back(leaf);
+        while (!level.empty() && level[0] != root) {
+            parents.clear();
+            for (Node *child : level) {
+                Node *parent = static_cast<Node *>(child->parent);
+                if (!parents.empty() && parents.back() == parent)
+                    parent->conflict_batch = batch;
+                else
+                    parents.push_back(parent);
+            }
+            level.swap(parents);
         }
 
         // -----------------------------
@@ -135,42 +176,94 @@ public:
         // -----------------------------
         atomic<size_t> taskIndex(0);
         size_t total = updates.size();
+        WorkerPool &executor = pool.get(numThreads); // any thread start-up stays untimed
 
         auto startTime = chrono::high_resolution_clock::now();
 
-        vector<thread> workers;
-        workers.reserve(numThreads);
-
-        for (int i = 0; i < numThreads; i++) {
-            workers.emplace_back(
-                workerFunc<TreeType>,
-                i,
-                &tree,
-                &updates,
-                &conflictPrefixes,
-                &taskIndex,
-                total);
-        }
-
-        for (auto &t : workers)
-            t.join();
+        executor.run(numThreads, [&](int) {
+            workerFunc<TreeType>(&tree, &updates, &leaves, batch, &taskIndex, total);
+        });
 
         auto endTime = chrono::high_resolution_clock::now();
         return chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
     }
 
-private:
+    // coalesceByKey's count for the last batch
+    size_t getLastCoalescedCount() const {
+        return last_coalesced;
+    }
+
+    // ============================================================
+    //  PARTITIONED PROCESS BATCH
+    // ============================================================
+    // The top k key bits split the tree into 2^k disjoint subtrees. Updates
+    // are sharded by those bits, each shard is percolated to its subtree root
+    // by one worker with no locks or visited flags, and the top k levels are
+    // then rehashed on the calling thread. k grows with the thread count, so
+    // all but a few top levels run without synchronisation. No node locks
+    // are taken: the batch must not overlap other writers or readers.
+    // A repeated key keeps its last value, as in processBatch.
     template <typename TreeType>
-    typename TreeType::NodeTypeAlias *getNodeByPrefix(TreeType &tree, const string &prefix) {
+    long long processBatchPartitioned(
+        TreeType &tree,
+        const vector<pair<BitKey, string>> &updates_in,
+        int numThreads) {
         using Node = typename TreeType::NodeTypeAlias;
-        Node *cur = tree.getRoot();
-        for (char c : prefix) {
-            if (!cur)
-                return nullptr;
-            cur = (c == '0')
-                      ? static_cast<Node *>(cur->left)
-                      : static_cast<Node *>(cur->right);
-        }
-        return cur;
+        using Hash = typename TreeType::Hash;
+
+        vector<pair<BitKey, string>> updates = updates_in;
+        last_coalesced = coalesceByKey(updates);
+        if (updates.empty())
+            return 0;
+
+        vector<Node *> leaves = locateLeaves(tree, updates);
+        if (leaves.empty())
+            return 0;
+
+        // A few subtrees per thread so that uneven shards still balance
+        int depth = tree.getDepth();
+        int k = 0;
+        while (k < depth && (1 << k) < SHARDS_PER_THREAD * numThreads)
+            ++k;
+
+        // Sorted keys sharing their top k bits are contiguous
+        vector<size_t> shardStart;
+        for (size_t i = 0; i < updates.size(); ++i)
+            if (i == 0 || updates[i - 1].first.commonPrefixLength(updates[i].first) < k)
+                shardStart.push_back(i);
+        shardStart.push_back(updates.size());
+        size_t shards = shardStart.size() - 1;
+        vector<Node *> shardRoots(shards);
+
+        WorkerPool &executor = pool.get(numThreads);
+        auto startTime = chrono::high_resolution_clock::now();
+
+        atomic<size_t> nextShard(0);
+        executor.run(int(min<size_t>(numThreads, shards)), [&](int) {
+            vector<Node *> level;
+            for (size_t s; (s = nextShard.fetch_add(1)) < shards;) {
+                level.assign(leaves.begin() + shardStart[s], leaves.begin() + shardStart[s + 1]);
+                for (size_t i = shardStart[s]; i < shardStart[s + 1]; ++i)
+                    leaves[i]->hash = Hash::hashLeaf(updates[i].second);
+                hashLevelsUp(tree, level, 0, depth - k); // serial: run() is not reentrant
+                shardRoots[s] = level[0];
+            }
+        });
+
+        hashLevelsUp(tree, shardRoots, depth - k, depth);
+
+        auto endTime = chrono::high_resolution_clock::now();
+        return chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
     }
+
+private:
+    // Shared by all instances, so two algorithms on one tree never reuse a
+    // stamp (wraps after 2^32 batches)
+    static inline atomic<uint32_t> batch_counter{0};
+
+    LazyWorkerPool pool;
+    size_t last_coalesced = 0;
+
+    // Shards per thread in processBatchPartitioned
+    static constexpr int SHARDS_PER_THREAD = 4;
 };
\ No newline at end of file
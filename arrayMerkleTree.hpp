@@ -0,0 +1,150 @@
+#pragma once
+#include "bitKey.hpp"
+#include "hashPolicy.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  Node layouts
+// ============================================================
+//
+// A layout maps a node, named by its level (root = 0) and its index within
+// that level, to a slot of the hash array:
+//
+//   position(level, index, depth)
+//
+// BfsLayout is the implicit heap: node i has children 2i+1 and 2i+2, so the
+// nodes of one leaf-to-root path are spread over depth cache lines.
+//
+// VebLayout is the van Emde Boas order: the tree is cut at half its height,
+// the top half is laid out first, then each bottom subtree in turn, each
+// recursively the same way. Any path crosses O(log depth) blocks at every
+// granularity (cache line, page), without tuning for either.
+
+struct BfsLayout {
+    static constexpr const char *name = "bfs";
+
+    static size_t position(int level, uint64_t index, int) {
+        return (size_t(1) << level) - 1 + index;
+    }
+};
+
+struct VebLayout {
+    static constexpr const char *name = "veb";
+
+    static size_t position(int level, uint64_t index, int depth) {
+        size_t pos = 0;
+        int height = depth + 1; // levels in the current subtree
+        while (height > 1) {
+            int top = height / 2;
+            int bottom = height - top;
+            if (level < top) {
+                height = top;
+                continue;
+            }
+            // Skip the top subtree and the bottom subtrees to our left
+            level -= top;
+            pos += ((size_t(1) << top) - 1) + (index >> level) * ((size_t(1) << bottom) - 1);
+            index &= (uint64_t(1) << level) - 1;
+            height = bottom;
+        }
+        return pos;
+    }
+};
+
+// ============================================================
+//  ArraySparseMerkleTree: pointer-free complete tree
+// ============================================================
+//
+// A complete tree stored as one contiguous array of hashes, ordered by the
+// Layout policy; the children of (level, i) are (level + 1, 2i) and
+// (level + 1, 2i + 1), and the leaf for key k is (depth, k). There are no node
+// objects, pointers or leaf map, so a tree of depth d takes exactly
+// 32 * (2^(d+1) - 1) bytes. Intended for dense trees; use SparseMerkleTree in
+// TreeMode::Sparse for large, mostly empty key spaces.
+
+template <typename HashPolicy = Sha256Hash, typename Layout = BfsLayout>
+class ArraySparseMerkleTree {
+public:
+    using Hash = HashPolicy;
+    using NodeLayout = Layout;
+
+    // Leaf indices must fit in 64 bits alongside the interior nodes
+    static constexpr int MAX_DEPTH = 62;
+
+private:
+    int depth;
+    vector<Digest> hashes;
+    vector<Digest> default_hashes;
+
+public:
+    ArraySparseMerkleTree(int tree_depth) : depth(tree_depth) {
+        default_hashes = defaultHashes<HashPolicy>(tree_depth, MAX_DEPTH);
+
+        // An empty tree is all defaults: level l holds 2^l nodes of height depth - l
+        hashes.resize(nodeCount());
+        for (int level = 0; level <= tree_depth; ++level)
+            for (uint64_t i = 0; i < (uint64_t(1) << level); ++i)
+                hashes[position(level, i)] = default_hashes[tree_depth - level];
+    }
+
+    int getDepth() const {
+        return depth;
+    }
+
+    size_t nodeCount() const {
+        return (size_t(2) << depth) - 1;
+    }
+
+    size_t getLeafCount() const {
+        return size_t(1) << depth;
+    }
+
+    string getRootHash() const {
+        return hashes[0].toHex();
+    }
+
+    const Digest &getDefaultHash(int height) const {
+        return default_hashes[height];
+    }
+
+    // Array slot of the index-th node of a level
+    size_t position(int level, uint64_t index) const {
+        return Layout::position(level, index, depth);
+    }
+
+    const Digest &getHash(int level, uint64_t index) const {
+        return hashes[position(level, index)];
+    }
+
+    Digest &getHash(int level, uint64_t index) {
+        return hashes[position(level, index)];
+    }
+
+    const Digest &getLeafHash(const BitKey &key) const {
+        return getHash(depth, key.toIndex());
+    }
+};
+
+template <typename HashPolicy, typename Layout>
+void updateSerial(ArraySparseMerkleTree<HashPolicy, Layout> &tree, const BitKey &key, const string &value) {
+    int level = tree.getDepth();
+    if (key.size() != level) {
+        throw runtime_error("Invalid key length");
+    }
+
+    uint64_t index = key.toIndex();
+    tree.getHash(level, index) = HashPolicy::hashLeaf(value);
+
+    // Percolate upwards
+    while (level > 0) {
+        --level;
+        index >>= 1;
+        tree.getHash(level, index) = HashPolicy::hashChildren(tree.getHash(level + 1, 2 * index),
+                                                              tree.getHash(level + 1, 2 * index + 1));
+    }
+}
@@ -1,4 +1,5 @@
 #include "angela.hpp"
+#include "liveQueue.hpp"
 #include "liveUpdates.hpp"
 #include "merkleTree.hpp"
 #include "utils.hpp"
@@ -12,88 +13,11 @@ using namespace std::chrono;
 
 long long workload_start = 0;
 
-template <typename TreeType, typename Algo>
-class LiveThreadPool {
-public:
-    TreeType &tree;
-    Algo &algo;
-    long long playback_start_time = 0;
-    int numThreads;
-    atomic<bool> stop{false};
-    queue<WorkloadEvent> q;
-    mutex q_mtx;
-    condition_variable cv;
-    vector<thread> workers;
-
-    vector<vector<long long>> response_times_per_thread;
-    static thread_local int update_counter;
-
-    LiveThreadPool(TreeType &t, Algo &a, int threads)
-        : tree(t), algo(a), numThreads(threads) {
-        response_times_per_thread.resize(threads);
-        workers.reserve(threads);
-        for (int i = 0; i < threads; i++)
-            workers.emplace_back(&LiveThreadPool::worker, this, i);
-    }
-
-    ~LiveThreadPool() {
-        {
-            lock_guard<mutex> lk(q_mtx);
-            stop = true;
-        }
-        cv.notify_all();
-        for (auto &w : workers)
-            if (w.joinable())
-                w.join();
-    }
-
-    void enqueue(const OperationRequest &op, long long arrival_us) {
-        lock_guard<mutex> lk(q_mtx);
-        q.push({op, arrival_us});
-        cv.notify_one();
-    }
-
-    void worker(int tid) {
-        while (true) {
-            WorkloadEvent job;
-
-            // wait for job
-            {
-                unique_lock<mutex> lk(q_mtx);
-                cv.wait(lk, [&] { return stop || !q.empty(); });
-                if (stop && q.empty())
-                    return;
-
-                job = q.front();
-                q.pop();
-            }
-
-            if (job.op.op_type == UPDATE) {
-                update_counter++;
-                ThreadUpdateId id(tid);
-                id.update_count = update_counter;
-                algo.update(tree, job.op.key, job.op.value, id);
-            } else if (job.op.op_type == READ_ROOT) {
-                tree.getRootHash();
-            } else if (job.op.op_type == READ_LEAF) {
-                tree.getLeafNode(job.op.key);
-            }
-
-            long long finish_us = now_us() - playback_start_time;
-            long long resp = finish_us - job.arrival_us;
-
-            response_times_per_thread[tid].push_back(resp);
-        }
-    }
-};
-
-template <typename T, typename A>
-thread_local int LiveThreadPool<T, A>::update_counter = 0;
-
 struct Result {
     long long avg_live, avg_angela, avg_serial;
     long long exec_live, exec_angela, exec_serial;
     string live_root, angela_root, serial_root;
+    size_t live_coalesced;
 };
 
 Result run_benchmark(
@@ -144,6 +68,7 @@ Result run_benchmark(
                  (double)live_rt.size();
 
     R.live_root = liveTree.getRootHash();
+    R.live_coalesced = pool.coalesced;
 
     // =============================
     // 2. ANGELA ALGORITHM (BATCHED)
@@ -154,7 +79,7 @@ Result run_benchmark(
     vector<long long> angela_rt;
     angela_rt.reserve(total_ops);
 
-    vector<pair<string, string>> batch;
+    vector<pair<BitKey, string>> batch;
     vector<long long> batch_arr;
     batch.reserve(batch_size);
     batch_arr.reserve(batch_size);
@@ -262,6 +187,7 @@ int main() {
 
         Result r = run_benchmark(
             16, total_ops, th, batch_size, workload_depth16);
+        cout << "Live updates coalesced : " << r.live_coalesced << "\n";
 
         csv1 << th << ","
              << r.avg_live << "," << r.avg_angela << "," << r.avg_serial << ","
@@ -290,6 +216,7 @@ int main() {
         cout << "Running depth=" << depth << " threads=32...\n";
 
         Result r = run_benchmark(depth, total_ops, 32, batch_size, workload_d);
+        cout << "Live updates coalesced : " << r.live_coalesced << "\n";
 
         csv2 << depth << ","
              << r.avg_live << "," << r.avg_angela << "," << r.avg_serial << ","
@@ -1,4 +1,5 @@
 #include "angela.hpp"
+#include "liveQueue.hpp"
 #include "liveUpdates.hpp"
 #include "merkleTree.hpp"
 #include "utils.hpp"
@@ -12,84 +13,6 @@ using namespace std::chrono;
 
 long long workload_start = 0;
 
-template <typename TreeType, typename Algo>
-class LiveThreadPool {
-public:
-    TreeType &tree;
-    Algo &algo;
-    long long playback_start_time = 0;
-    int numThreads;
-    atomic<bool> stop{false};
-    queue<WorkloadEvent> q;
-    mutex q_mtx;
-    condition_variable cv;
-    vector<thread> workers;
-
-    vector<vector<long long>> response_times_per_thread;
-    static thread_local int update_counter;
-
-    LiveThreadPool(TreeType &t, Algo &a, int threads)
-        : tree(t), algo(a), numThreads(threads) {
-        response_times_per_thread.resize(threads);
-        workers.reserve(threads);
-        for (int i = 0; i < threads; i++)
-            workers.emplace_back(&LiveThreadPool::worker, this, i);
-    }
-
-    ~LiveThreadPool() {
-        {
-            lock_guard<mutex> lk(q_mtx);
-            stop = true;
-        }
-        cv.notify_all();
-        for (auto &w : workers)
-            if (w.joinable())
-                w.join();
-    }
-
-    void enqueue(const OperationRequest &op, long long arrival_us) {
-        lock_guard<mutex> lk(q_mtx);
-        q.push({op, arrival_us});
-        cv.notify_one();
-    }
-
-    void worker(int tid) {
-        while (true) {
-            WorkloadEvent job;
-
-            // wait for job
-            {
-                unique_lock<mutex> lk(q_mtx);
-                cv.wait(lk, [&] { return stop || !q.empty(); });
-                if (stop && q.empty())
-                    return;
-
-                job = q.front();
-                q.pop();
-            }
-
-            if (job.op.op_type == UPDATE) {
-                update_counter++;
-                ThreadUpdateId id(tid);
-                id.update_count = update_counter;
-                algo.update(tree, job.op.key, job.op.value, id);
-            } else if (job.op.op_type == READ_ROOT) {
-                tree.getRootHash();
-            } else if (job.op.op_type == READ_LEAF) {
-                tree.getLeafNode(job.op.key);
-            }
-
-            long long finish_us = now_us() - playback_start_time;
-            long long resp = finish_us - job.arrival_us;
-
-            response_times_per_thread[tid].push_back(resp);
-        }
-    }
-};
-
-template <typename T, typename A>
-thread_local int LiveThreadPool<T, A>::update_counter = 0;
-
 // ===============================================================
 //                          MAIN
 // ===============================================================
@@ -151,6 +74,7 @@ int main() {
     long long live_total_ms =
         (now_us() - playback_start) / 1000;
     cout << "Live ALgorithm finished in " << live_total_ms << " ms\n";
+    cout << "Live updates coalesced : " << pool.coalesced << "\n";
 
     // ===========================================================
     // 3. ANGELA (batch)
@@ -163,12 +87,13 @@ int main() {
     vector<long long> angela_rt;
     angela_rt.reserve(total_ops);
 
-    vector<pair<string, string>> batch;
+    vector<pair<BitKey, string>> batch;
     vector<long long> batch_arrivals;
     batch.reserve(batch_size);
     batch_arrivals.reserve(batch_size);
 
     long long angela_batch_start, angela_batch_finish;
+    size_t angela_coalesced = 0;
     long long exec_start = now_us();
 
     for (auto &evt : stream) {
@@ -185,6 +110,7 @@ int main() {
 
             long long ms = angela.processBatch(angelaTree, batch, numThreads);
             angela_batch_finish = now_us();
+            angela_coalesced += angela.getLastCoalescedCount();
 
             for (size_t i = 0; i < batch.size(); i++) {
                 angela_rt.push_back(angela_batch_finish - exec_start - batch_arrivals[i]);
@@ -199,6 +125,7 @@ int main() {
         long long s = now_us() - workload_start;
         long long ms = angela.processBatch(angelaTree, batch, numThreads);
         long long f = now_us();
+        angela_coalesced += angela.getLastCoalescedCount();
 
         for (size_t i = 0; i < batch.size(); i++)
             angela_rt.push_back(f - exec_start - batch_arrivals[i]);
@@ -206,6 +133,7 @@ int main() {
     long long angela_finish = now_us();
     long long angela_execution_time = (angela_finish - exec_start) / 1000;
     cout << "Angela algorithm finished in " << angela_execution_time << " ms.\n";
+    cout << "Angela updates coalesced : " << angela_coalesced << "\n";
 
     // ===========================================================
     // 4. SERIAL
@@ -0,0 +1,244 @@
+#pragma once
+#include "digest.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  BitKey: packed binary path of up to 256 bits
+// ============================================================
+//
+// Bit i is the branch taken at depth i (0 = left, 1 = right). Bits are stored
+// most significant first, so comparing words compares keys lexicographically,
+// and every bit past length is kept zero so a prefix compares and hashes as a
+// plain value. A node's key is the prefix of length equal to its depth.
+
+struct BitKey {
+    static constexpr int MAX_BITS = 256;
+    static constexpr int WORDS = MAX_BITS / 64;
+
+    uint64_t words[WORDS];
+    int length;
+
+    // All-zero key of the given length
+    explicit BitKey(int bits = 0) : words(), length(bits) {
+        if (bits < 0 || bits > MAX_BITS)
+            throw invalid_argument("BitKey length out of range: " + to_string(bits));
+    }
+
+    // From a string of '0'/'1' characters
+    static BitKey fromBits(const string &bits) {
+        BitKey key((int)bits.size());
+        for (int i = 0; i < key.length; ++i) {
+            if (bits[i] != '0' && bits[i] != '1')
+                throw invalid_argument("BitKey expects only '0'/'1' characters");
+            key.setBit(i, bits[i] == '1');
+        }
+        return key;
+    }
+
+    // Leaf index of a tree of the given depth; bit 0 is the top bit of index
+    static BitKey fromIndex(uint64_t index, int bits) {
+        if (bits > 64)
+            throw invalid_argument("BitKey::fromIndex supports at most 64 bits");
+        BitKey key(bits);
+        if (bits > 0)
+            key.words[0] = index << (64 - bits);
+        return key;
+    }
+
+    // 256-bit key taken from a digest, first byte first
+    static BitKey fromDigest(const Digest &digest) {
+        BitKey key(MAX_BITS);
+        for (int w = 0; w < WORDS; ++w) {
+            uint64_t v = 0;
+            for (int b = 0; b < 8; ++b)
+                v = (v << 8) | digest.bytes[8 * w + b];
+            key.words[w] = v;
+        }
+        return key;
+    }
+
+    // Inverse of fromIndex: the key read as an unsigned integer
+    uint64_t toIndex() const {
+        if (length > 64)
+            throw invalid_argument("BitKey::toIndex supports at most 64 bits");
+        return length ? words[0] >> (64 - length) : 0;
+    }
+
+    int size() const {
+        return length;
+    }
+
+    bool bit(int i) const {
+        return (words[i >> 6] >> (63 - (i & 63))) & 1;
+    }
+
+    void setBit(int i, bool value) {
+        uint64_t mask = uint64_t(1) << (63 - (i & 63));
+        if (value)
+            words[i >> 6] |= mask;
+        else
+            words[i >> 6] &= ~mask;
+    }
+
+    // First n bits, with the rest cleared
+    BitKey prefix(int n) const {
+        BitKey result(n);
+        int full = n >> 6;
+        memcpy(result.words, words, full * sizeof(uint64_t));
+        if (n & 63)
+            result.words[full] = words[full] & (~uint64_t(0) << (64 - (n & 63)));
+        return result;
+    }
+
+    // Number of leading bits shared with other
+    int commonPrefixLength(const BitKey &other) const {
+        int limit = length < other.length ? length : other.length;
+        for (int w = 0; w < WORDS && 64 * w < limit; ++w) {
+            uint64_t diff = words[w] ^ other.words[w];
+            if (diff) {
+                int common = 64 * w + __builtin_clzll(diff);
+                return common < limit ? common : limit;
+            }
+        }
+        return limit;
+    }
+
+    string toString() const {
+        string bits(length, '0');
+        for (int i = 0; i < length; ++i)
+            if (bit(i))
+                bits[i] = '1';
+        return bits;
+    }
+
+    bool operator==(const BitKey &other) const {
+        return length == other.length && memcmp(words, other.words, sizeof(words)) == 0;
+    }
+
+    bool operator!=(const BitKey &other) const {
+        return !(*this == other);
+    }
+
+    // Lexicographic, a proper prefix sorting first (same order as the strings)
+    bool operator<(const BitKey &other) const {
+        for (int w = 0; w < WORDS; ++w)
+            if (words[w] != other.words[w])
+                return words[w] < other.words[w];
+        return length < other.length;
+    }
+};
+
+namespace std {
+template <>
+struct hash<BitKey> {
+    size_t operator()(const BitKey &key) const {
+        uint64_t h = uint64_t(key.length);
+        for (int w = 0; w < BitKey::WORDS; ++w) {
+            h = (h ^ key.words[w]) * 0x9e3779b97f4a7c15ULL;
+            h ^= h >> 32;
+        }
+        return size_t(h);
+    }
+};
+} // namespace std
+
+// Batches smaller than this are not worth the radix sort's counting passes
+static constexpr size_t RADIX_SORT_MIN = 64;
+
+// Stable sort of key/value pairs by key. When every key has the same length,
+// the keys are LSD radix sorted a byte at a time on the first 64-bit word in
+// which they differ (one pass per byte that not all keys share), and the
+// pairs are moved once into their final order; for longer keys the runs that
+// tie on that word are then finished with stable_sort. Batches of mixed
+// lengths use stable_sort, and sorted input is left as is.
+template <typename T>
+void sortByKey(vector<pair<BitKey, T>> &entries) {
+    auto byKey = [](const pair<BitKey, T> &a, const pair<BitKey, T> &b) { return a.first < b.first; };
+    if (is_sorted(entries.begin(), entries.end(), byKey))
+        return;
+
+    size_t n = entries.size();
+    int bits = entries[0].first.size();
+    bool radix = n >= RADIX_SORT_MIN;
+    for (size_t i = 0; radix && i < n; ++i)
+        radix = entries[i].first.size() == bits;
+    if (!radix) {
+        stable_sort(entries.begin(), entries.end(), byKey);
+        return;
+    }
+
+    // The leading words every key shares cannot reorder anything, nor can
+    // the bytes of the first differing word that every key shares
+    int lead = 0;
+    uint64_t diff;
+    while (true) {
+        diff = 0;
+        for (size_t i = 0; i < n; ++i)
+            diff |= entries[i].first.words[lead] ^ entries[0].first.words[lead];
+        if (diff || 64 * (lead + 1) >= bits)
+            break;
+        ++lead;
+    }
+
+    vector<size_t> order(n), next(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    int passes = (min(bits - 64 * lead, 64) + 7) / 8;
+    for (int p = 0; p < passes; ++p) {
+        int shift = 64 - 8 * passes + 8 * p;
+        if (((diff >> shift) & 0xff) == 0)
+            continue;
+        size_t count[257] = {};
+        for (size_t i = 0; i < n; ++i)
+            ++count[((entries[i].first.words[lead] >> shift) & 0xff) + 1];
+        for (int b = 0; b < 256; ++b)
+            count[b + 1] += count[b];
+        for (size_t i : order)
+            next[count[(entries[i].first.words[lead] >> shift) & 0xff]++] = i;
+        order.swap(next);
+    }
+
+    vector<pair<BitKey, T>> sorted;
+    sorted.reserve(n);
+    for (size_t i : order)
+        sorted.push_back(move(entries[i]));
+    entries.swap(sorted);
+
+    if (64 * (lead + 1) >= bits)
+        return;
+    for (size_t begin = 0, end; begin < n; begin = end) {
+        for (end = begin + 1; end < n && entries[end].first.words[lead] == entries[begin].first.words[lead]; ++end) {
+        }
+        if (end - begin > 1)
+            stable_sort(entries.begin() + begin, entries.begin() + end, byKey);
+    }
+}
+
+// Sorts by key and keeps only the last value given for each key (input order
+// decides, as the sort is stable). Returns the coalesced count: how many
+// entries were dropped because a later entry wrote the same key. Batch
+// algorithms report it for their last batch as getLastCoalescedCount().
+template <typename T>
+size_t coalesceByKey(vector<pair<BitKey, T>> &entries) {
+    sortByKey(entries);
+    size_t kept = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i + 1 < entries.size() && entries[i + 1].first == entries[i].first)
+            continue;
+        if (kept != i)
+            entries[kept] = move(entries[i]);
+        ++kept;
+    }
+    size_t dropped = entries.size() - kept;
+    entries.resize(kept);
+    return dropped;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "digest.hpp"
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// ============================================================
+//  BLAKE2s-256
+// ============================================================
+//
+// Unkeyed BLAKE2s with a 32-byte output. A 64-byte parent message is exactly
+// one block, so a parent costs one compression with the final flag set.
+
+static constexpr uint32_t BLAKE2S_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+static constexpr uint8_t BLAKE2S_SIGMA[10][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}};
+
+static inline uint32_t loadLittleEndian32(const uint8_t *p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline void storeLittleEndian32(uint8_t *p, uint32_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+static inline uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// Quarter-round shared by BLAKE2s and BLAKE3
+static inline void blakeMix(uint32_t v[16], int a, int b, int c, int d, uint32_t x, uint32_t y) {
+    v[a] = v[a] + v[b] + x;
+    v[d] = rotr32(v[d] ^ v[a], 16);
+    v[c] = v[c] + v[d];
+    v[b] = rotr32(v[b] ^ v[c], 12);
+    v[a] = v[a] + v[b] + y;
+    v[d] = rotr32(v[d] ^ v[a], 8);
+    v[c] = v[c] + v[d];
+    v[b] = rotr32(v[b] ^ v[c], 7);
+}
+
+static void blake2sCompress(uint32_t h[8], const uint8_t block[64], uint64_t counter, bool last) {
+    uint32_t m[16], v[16];
+    for (int i = 0; i < 16; ++i)
+        m[i] = loadLittleEndian32(block + 4 * i);
+    for (int i = 0; i < 8; ++i) {
+        v[i] = h[i];
+        v[i + 8] = BLAKE2S_IV[i];
+    }
+    v[12] ^= uint32_t(counter);
+    v[13] ^= uint32_t(counter >> 32);
+    if (last)
+        v[14] = ~v[14];
+
+    for (int r = 0; r < 10; ++r) {
+        const uint8_t *s = BLAKE2S_SIGMA[r];
+        blakeMix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        blakeMix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        blakeMix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        blakeMix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        blakeMix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        blakeMix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        blakeMix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        blakeMix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; ++i)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+static void blake2sInit(uint32_t h[8]) {
+    memcpy(h, BLAKE2S_IV, 8 * sizeof(uint32_t));
+    h[0] ^= 0x01010000 ^ uint32_t(Digest::SIZE); // depth 1, fanout 1, no key
+}
+
+static Digest blake2sFinish(const uint32_t h[8]) {
+    Digest result;
+    for (int i = 0; i < 8; ++i)
+        storeLittleEndian32(result.bytes + 4 * i, h[i]);
+    return result;
+}
+
+Digest blake2sHash(const uint8_t *data, size_t length) {
+    uint32_t h[8];
+    blake2sInit(h);
+
+    // The last (possibly empty or partial) block always carries the final flag
+    size_t offset = 0;
+    while (length - offset > 64) {
+        blake2sCompress(h, data + offset, offset + 64, false);
+        offset += 64;
+    }
+    uint8_t block[64] = {};
+    memcpy(block, data + offset, length - offset);
+    blake2sCompress(h, block, length, true);
+
+    return blake2sFinish(h);
+}
+
+Digest blake2sHashChildren(const Digest &left, const Digest &right) {
+    uint32_t h[8];
+    blake2sInit(h);
+
+    uint8_t block[64];
+    memcpy(block, left.bytes, Digest::SIZE);
+    memcpy(block + Digest::SIZE, right.bytes, Digest::SIZE);
+    blake2sCompress(h, block, 64, true);
+
+    return blake2sFinish(h);
+}
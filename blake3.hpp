@@ -0,0 +1,131 @@
+#pragma once
+#include "blake2s.hpp"
+#include "digest.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// ============================================================
+//  BLAKE3 (hash mode, 32-byte output)
+// ============================================================
+//
+// Input is split into 1 KiB chunks of 64-byte blocks; chunk chaining values
+// are merged through a binary tree of parent compressions. A 64-byte parent
+// message is a single-block, single-chunk root: one 7-round compression.
+
+static constexpr uint32_t BLAKE3_CHUNK_START = 1 << 0;
+static constexpr uint32_t BLAKE3_CHUNK_END = 1 << 1;
+static constexpr uint32_t BLAKE3_PARENT = 1 << 2;
+static constexpr uint32_t BLAKE3_ROOT = 1 << 3;
+static constexpr size_t BLAKE3_BLOCK_LEN = 64;
+static constexpr size_t BLAKE3_CHUNK_LEN = 1024;
+
+static constexpr uint8_t BLAKE3_MSG_PERMUTATION[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+
+// Message word order of every round: the permutation applied round times
+static constexpr array<array<uint8_t, 16>, 7> makeBlake3Schedule() {
+    array<array<uint8_t, 16>, 7> schedule{};
+    for (int i = 0; i < 16; ++i)
+        schedule[0][i] = uint8_t(i);
+    for (int r = 1; r < 7; ++r)
+        for (int i = 0; i < 16; ++i)
+            schedule[r][i] = schedule[r - 1][BLAKE3_MSG_PERMUTATION[i]];
+    return schedule;
+}
+
+static constexpr array<array<uint8_t, 16>, 7> BLAKE3_SCHEDULE = makeBlake3Schedule();
+
+// Compresses one block into the chaining value cv (first 8 output words)
+static void blake3Compress(uint32_t cv[8], const uint8_t block[64], uint32_t blockLen, uint64_t counter, uint32_t flags) {
+    uint32_t m[16], v[16];
+    for (int i = 0; i < 16; ++i)
+        m[i] = loadLittleEndian32(block + 4 * i);
+    for (int i = 0; i < 8; ++i)
+        v[i] = cv[i];
+    for (int i = 0; i < 4; ++i)
+        v[i + 8] = BLAKE2S_IV[i];
+    v[12] = uint32_t(counter);
+    v[13] = uint32_t(counter >> 32);
+    v[14] = blockLen;
+    v[15] = flags;
+
+    for (int r = 0; r < 7; ++r) {
+        const uint8_t *s = BLAKE3_SCHEDULE[r].data();
+        blakeMix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        blakeMix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        blakeMix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        blakeMix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        blakeMix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        blakeMix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        blakeMix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        blakeMix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; ++i)
+        cv[i] = v[i] ^ v[i + 8];
+}
+
+static void blake3Chunk(uint32_t cv[8], const uint8_t *data, size_t length, uint64_t chunkCounter, uint32_t rootFlag) {
+    memcpy(cv, BLAKE2S_IV, 8 * sizeof(uint32_t));
+
+    size_t offset = 0;
+    uint32_t flags = BLAKE3_CHUNK_START;
+    while (length - offset > BLAKE3_BLOCK_LEN) {
+        blake3Compress(cv, data + offset, BLAKE3_BLOCK_LEN, chunkCounter, flags);
+        offset += BLAKE3_BLOCK_LEN;
+        flags = 0;
+    }
+    uint8_t block[BLAKE3_BLOCK_LEN] = {};
+    memcpy(block, data + offset, length - offset);
+    blake3Compress(cv, block, uint32_t(length - offset), chunkCounter, flags | BLAKE3_CHUNK_END | rootFlag);
+}
+
+// Left subtree takes the largest power-of-two number of chunks that leaves
+// at least one byte for the right subtree
+static void blake3Subtree(uint32_t cv[8], const uint8_t *data, size_t length, uint64_t chunkCounter, uint32_t rootFlag) {
+    if (length <= BLAKE3_CHUNK_LEN) {
+        blake3Chunk(cv, data, length, chunkCounter, rootFlag);
+        return;
+    }
+
+    size_t leftChunks = 1;
+    while (2 * leftChunks * BLAKE3_CHUNK_LEN < length)
+        leftChunks *= 2;
+    size_t leftLength = leftChunks * BLAKE3_CHUNK_LEN;
+
+    uint32_t children[16];
+    blake3Subtree(children, data, leftLength, chunkCounter, 0);
+    blake3Subtree(children + 8, data + leftLength, length - leftLength, chunkCounter + leftChunks, 0);
+
+    uint8_t block[BLAKE3_BLOCK_LEN];
+    for (int i = 0; i < 16; ++i)
+        storeLittleEndian32(block + 4 * i, children[i]);
+    memcpy(cv, BLAKE2S_IV, 8 * sizeof(uint32_t));
+    blake3Compress(cv, block, BLAKE3_BLOCK_LEN, 0, BLAKE3_PARENT | rootFlag);
+}
+
+static Digest blake3Finish(const uint32_t cv[8]) {
+    Digest result;
+    for (int i = 0; i < 8; ++i)
+        storeLittleEndian32(result.bytes + 4 * i, cv[i]);
+    return result;
+}
+
+Digest blake3Hash(const uint8_t *data, size_t length) {
+    uint32_t cv[8];
+    blake3Subtree(cv, data, length, 0, BLAKE3_ROOT);
+    return blake3Finish(cv);
+}
+
+Digest blake3HashChildren(const Digest &left, const Digest &right) {
+    uint8_t block[BLAKE3_BLOCK_LEN];
+    memcpy(block, left.bytes, Digest::SIZE);
+    memcpy(block + Digest::SIZE, right.bytes, Digest::SIZE);
+
+    uint32_t cv[8];
+    memcpy(cv, BLAKE2S_IV, sizeof(cv));
+    blake3Compress(cv, block, BLAKE3_BLOCK_LEN, 0, BLAKE3_CHUNK_START | BLAKE3_CHUNK_END | BLAKE3_ROOT);
+    return blake3Finish(cv);
+}
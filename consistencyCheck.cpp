@@ -0,0 +1,240 @@
+#include "angela.hpp"
+#include "arrayMerkleTree.hpp"
+#include "levelSync.hpp"
+#include "merkleTree.hpp"
+#include "utils.hpp"
+#include "versionedTree.hpp"
+#include "workLoad.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+using namespace std;
+
+// ============================================================
+//  Consistency check: every tree and batch path against serial
+// ============================================================
+//
+// Each structure replays the same update stream and must end with the root
+// of a complete SparseMerkleTree updated by updateSerial. A quarter of the
+// updates hit a few hot keys, so batches repeat keys and last-writer-wins
+// coalescing is exercised too. Proofs taken from the resulting trees must
+// verify, and must stop verifying once tampered with. Exits non-zero if any
+// check fails.
+//
+// Usage: ./consistencyCheck.out [depth] [updates] [batch size]
+
+using Batch = vector<pair<BitKey, string>>;
+
+static int failures = 0;
+
+static void check(const string &name, bool ok) {
+    if (!ok)
+        ++failures;
+    cout << (ok ? "PASSED" : "FAILED") << "  " << name << endl;
+}
+
+// Calls apply(batch) for consecutive batches of the stream, in order
+template <typename Fn>
+static void inBatches(const Batch &stream, size_t batchSize, Fn apply) {
+    for (size_t begin = 0; begin < stream.size(); begin += batchSize) {
+        size_t end = min(stream.size(), begin + batchSize);
+        apply(Batch(stream.begin() + begin, stream.begin() + end));
+    }
+}
+
+// Round trips proofs from a tree holding the stream through ProofVerifier:
+// inclusion, batch and multi proofs of written keys, and non-membership of
+// a key never written, each with a tampered counterpart that must fail
+static void checkProofs(const Batch &stream, int depth, TreeMode mode, const string &suffix) {
+    SparseMerkleTree<MerkleNode> tree(depth, mode);
+    unordered_map<BitKey, string> latest;
+    for (const auto &update : stream) {
+        updateSerial(tree, update.first, update.second);
+        latest[update.first] = update.second;
+    }
+    ProofVerifier<> verifier(depth);
+    Digest root = tree.readRootHash();
+
+    // A few written keys and their current values
+    vector<BitKey> keys;
+    vector<string> values;
+    for (const auto &entry : latest) {
+        if (keys.size() == 32)
+            break;
+        keys.push_back(entry.first);
+        values.push_back(entry.second);
+    }
+
+    bool valid = true, tampered = false;
+    vector<MerkleProof> proofs;
+    vector<Digest> leafHashes;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        MerkleProof proof = tree.getProof(keys[i]);
+        valid = valid && verifier.verify(root, proof, values[i]);
+        tampered = tampered || verifier.verify(root, proof, values[i] + "x");
+        if (!proof.siblings.empty()) {
+            MerkleProof forged = proof;
+            forged.siblings[0].bytes[0] ^= 1;
+            tampered = tampered || verifier.verify(root, forged, values[i]);
+        }
+        proofs.push_back(move(proof));
+        leafHashes.push_back(Sha256Hash::hashLeaf(values[i]));
+    }
+    check("Inclusion proofs verify" + suffix, valid);
+    check("Tampered inclusion proofs fail" + suffix, !tampered);
+
+    vector<bool> batch = verifier.verifyBatch(root, proofs, leafHashes);
+    check("Batch verification" + suffix, count(batch.begin(), batch.end(), true) == long(proofs.size()));
+
+    // Multiproof values follow the proof's sorted key order
+    MerkleMultiProof multi = tree.getMultiProof(keys);
+    vector<string> sortedValues;
+    for (const BitKey &key : multi.keys)
+        sortedValues.push_back(latest[key]);
+    check("Multiproof verifies" + suffix, verifier.verifyMulti(root, multi, sortedValues));
+    sortedValues.back() += "x";
+    check("Multiproof with a wrong value fails" + suffix, !verifier.verifyMulti(root, multi, sortedValues));
+
+    if (latest.size() == size_t(1) << depth)
+        return; // every key written: nothing is absent
+    BitKey absent;
+    do {
+        absent = generate_random_key(depth);
+    } while (latest.count(absent));
+    NonMembershipProof missing = tree.getNonMembershipProof(absent);
+    check("Non-membership proof verifies" + suffix, verifier.verifyNonMembership(root, missing));
+
+    // Once the key is written, the old absence proof must not hold
+    updateSerial(tree, absent, "present");
+    check("Stale non-membership proof fails" + suffix, !verifier.verifyNonMembership(tree.readRootHash(), missing));
+}
+
+// Proofs from a snapshot pinned halfway through the stream must still verify
+// against that snapshot's root after the rest of the stream is committed,
+// even though the version has dropped out of the tree's history by then
+static void checkSnapshotProofs(const Batch &stream, int depth, size_t batchSize) {
+    VersionedMerkleTree<> tree(depth);
+    Batch first(stream.begin(), stream.begin() + stream.size() / 2);
+    Batch rest(stream.begin() + stream.size() / 2, stream.end());
+    inBatches(first, batchSize, [&](Batch batch) { tree.commit(move(batch)); });
+
+    unordered_map<BitKey, string> pinnedValues;
+    for (const auto &update : first)
+        pinnedValues[update.first] = update.second;
+
+    auto snapshot = tree.snapshot();
+    Digest root = snapshot.rootHash();
+    inBatches(rest, batchSize, [&](Batch batch) { tree.commit(move(batch)); });
+
+    ProofVerifier<> verifier(depth);
+    bool valid = true, stale = false;
+    size_t checked = 0;
+    for (const auto &entry : pinnedValues) {
+        if (checked++ == 32)
+            break;
+        MerkleProof proof = snapshot.getProof(entry.first);
+        valid = valid && verifier.verify(root, proof, entry.second);
+        stale = stale || verifier.verify(tree.snapshot().rootHash(), proof, entry.second);
+    }
+    check("Old snapshot proofs verify after later commits", valid);
+    check("Old snapshot proofs fail against the newest root", !stale);
+
+    if (pinnedValues.size() == size_t(1) << depth)
+        return;
+    BitKey absent;
+    do {
+        absent = generate_random_key(depth);
+    } while (pinnedValues.count(absent));
+    NonMembershipProof missing = snapshot.getNonMembershipProof(absent);
+    check("Old snapshot non-membership proof verifies", verifier.verifyNonMembership(root, missing));
+}
+
+int main(int argc, char **argv) {
+    int depth = argc > 1 ? atoi(argv[1]) : 12;
+    int total = argc > 2 ? atoi(argv[2]) : 20000;
+    size_t batchSize = argc > 3 ? atoi(argv[3]) : 512;
+    int threads = max(2u, thread::hardware_concurrency());
+
+    // Complete trees are built in full, so keep them small
+    if (depth < 1 || depth > 24 || total <= 0 || batchSize == 0) {
+        cout << "Expected 1 <= depth <= 24, updates > 0 and batch size > 0." << endl;
+        return 1;
+    }
+
+    srand(42);
+    vector<BitKey> hot;
+    for (int i = 0; i < 8; ++i)
+        hot.push_back(generate_random_key(depth));
+    Batch stream;
+    stream.reserve(total);
+    for (int i = 0; i < total; ++i) {
+        BitKey key = rand() % 4 ? generate_random_key(depth) : hot[rand() % hot.size()];
+        stream.emplace_back(key, to_string(i));
+    }
+
+    SparseMerkleTree<MerkleNode> reference(depth);
+    for (const auto &update : stream)
+        updateSerial(reference, update.first, update.second);
+    string expected = reference.getRootHash();
+    cout << "Depth=" << depth << " Updates=" << total << " Batch=" << batchSize << " Threads=" << threads << endl;
+    cout << "Reference root (updateSerial): " << expected << endl;
+
+    {
+        SparseMerkleTree<MerkleNode> tree(depth, TreeMode::Sparse);
+        for (const auto &update : stream)
+            updateSerial(tree, update.first, update.second);
+        check("SparseMerkleTree sparse, updateSerial", tree.getRootHash() == expected);
+    }
+    {
+        ArraySparseMerkleTree<Sha256Hash, BfsLayout> tree(depth);
+        for (const auto &update : stream)
+            updateSerial(tree, update.first, update.second);
+        check("ArraySparseMerkleTree BFS layout", tree.getRootHash() == expected);
+    }
+    {
+        ArraySparseMerkleTree<Sha256Hash, VebLayout> tree(depth);
+        for (const auto &update : stream)
+            updateSerial(tree, update.first, update.second);
+        check("ArraySparseMerkleTree vEB layout", tree.getRootHash() == expected);
+    }
+    {
+        VersionedMerkleTree<> tree(depth);
+        inBatches(stream, batchSize, [&](Batch batch) { tree.commit(move(batch)); });
+        check("VersionedMerkleTree commit", tree.getRootHash() == expected);
+    }
+    checkSnapshotProofs(stream, depth, batchSize);
+
+    for (TreeMode mode : {TreeMode::Complete, TreeMode::Sparse}) {
+        string suffix = mode == TreeMode::Complete ? " (complete)" : " (sparse)";
+        {
+            SparseMerkleTree<MerkleNode> tree(depth, stream, mode);
+            check("SparseMerkleTree bulk load" + suffix, tree.getRootHash() == expected);
+        }
+        {
+            SparseMerkleTree<MerkleNode> tree(depth, mode);
+            LevelSyncAlgorithm levelSync;
+            inBatches(stream, batchSize, [&](const Batch &batch) { levelSync.processBatch(tree, batch, threads); });
+            check("LevelSyncAlgorithm processBatch" + suffix, tree.getRootHash() == expected);
+        }
+        {
+            SparseMerkleTree<AngelaNode> tree(depth, mode);
+            AngelaAlgorithm angela;
+            inBatches(stream, batchSize, [&](const Batch &batch) { angela.processBatch(tree, batch, threads); });
+            check("AngelaAlgorithm processBatch" + suffix, tree.getRootHash() == expected);
+        }
+        {
+            SparseMerkleTree<AngelaNode> tree(depth, mode);
+            AngelaAlgorithm angela;
+            inBatches(stream, batchSize, [&](const Batch &batch) {
+                angela.processBatchPartitioned(tree, batch, threads);
+            });
+            check("AngelaAlgorithm processBatchPartitioned" + suffix, tree.getRootHash() == expected);
+        }
+        checkProofs(stream, depth, mode, suffix);
+    }
+
+    cout << (failures ? "Consistency check: FAILED" : "Consistency check: PASSED") << endl;
+    return failures ? 1 : 0;
+}
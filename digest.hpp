@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <openssl/sha.h>
+#include <string>
+#include <type_traits>
+
+using namespace std;
+
+// Fixed-size binary hash value stored inline in every node.
+// Hex is only produced at the API edge (getRootHash, printing).
+struct Digest {
+    static constexpr size_t SIZE = SHA256_DIGEST_LENGTH;
+    uint8_t bytes[SIZE];
+
+    bool operator==(const Digest &other) const {
+        return memcmp(bytes, other.bytes, SIZE) == 0;
+    }
+
+    bool operator!=(const Digest &other) const {
+        return !(*this == other);
+    }
+
+    string toHex() const {
+        static const char digits[] = "0123456789abcdef";
+        string result(2 * SIZE, '0');
+        for (size_t i = 0; i < SIZE; ++i) {
+            result[2 * i] = digits[bytes[i] >> 4];
+            result[2 * i + 1] = digits[bytes[i] & 0x0f];
+        }
+        return result;
+    }
+};
+
+static_assert(is_trivially_copyable<Digest>::value, "Digest must be trivially copyable");
+static_assert(sizeof(Digest) == Digest::SIZE, "Digest must not carry padding");
+
+// Hash function using SHA256
+Digest computeHash(const uint8_t *data, size_t length) {
+    Digest result;
+    SHA256(data, length, result.bytes);
+    return result;
+}
+
+Digest computeHash(const string &data) {
+    return computeHash(reinterpret_cast<const uint8_t *>(data.data()), data.length());
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "nodeLock.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  EpochManager: epoch-based reclamation
+// ============================================================
+//
+// Readers bracket their accesses with enter()/exit(), which publishes the
+// global epoch they started in. A single writer unlinks objects, retire()s
+// them, and calls advance(); an object retired in epoch e is freed once no
+// reader is still active in an epoch <= e, since any later reader can only
+// have found the structure without it. Readers never block and never write
+// shared state other than their own slot.
+
+class EpochManager {
+public:
+    static constexpr int MAX_READERS = 128;
+
+private:
+    // One cache line per reader; 0 means the slot is free
+    struct alignas(64) Slot {
+        atomic<uint64_t> epoch{0};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        void *object;
+        void (*destroy)(void *);
+    };
+
+    Slot slots[MAX_READERS];
+    atomic<uint64_t> global_epoch{1};
+    vector<Retired> retired; // writer only
+
+public:
+    EpochManager() = default;
+    EpochManager(const EpochManager &) = delete;
+    EpochManager &operator=(const EpochManager &) = delete;
+
+    ~EpochManager() {
+        for (Retired &r : retired)
+            r.destroy(r.object);
+    }
+
+    // Claims a free slot stamped with the current epoch; returns its index
+    int enter() {
+        static thread_local int hint = int(hash<thread::id>()(this_thread::get_id()) % MAX_READERS);
+        int spins = 0;
+        while (true) {
+            uint64_t epoch = global_epoch.load();
+            for (int i = 0; i < MAX_READERS; ++i) {
+                int s = (hint + i) % MAX_READERS;
+                uint64_t expected = 0;
+                if (slots[s].epoch.load(memory_order_relaxed) == 0 &&
+                    slots[s].epoch.compare_exchange_strong(expected, epoch)) {
+                    hint = s;
+                    return s;
+                }
+            }
+            spinWait(spins);
+        }
+    }
+
+    void exit(int slot) {
+        slots[slot].epoch.store(0, memory_order_release);
+    }
+
+    // Writer only: object becomes unreachable for readers entering from now
+    // on; destroy(object) runs once none can still hold it
+    void retire(void *object, void (*destroy)(void *)) {
+        retired.push_back({global_epoch.load(), object, destroy});
+    }
+
+    template <typename T>
+    void retire(T *object) {
+        retire(const_cast<void *>(static_cast<const void *>(object)), [](void *p) { delete static_cast<T *>(p); });
+    }
+
+    // Writer only: closes the current epoch and frees what no reader can hold
+    size_t advanceAndReclaim() {
+        global_epoch.fetch_add(1);
+
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot &slot : slots) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < oldest)
+                oldest = epoch;
+        }
+
+        size_t kept = 0, freed = 0;
+        for (Retired &r : retired) {
+            if (r.epoch < oldest) {
+                r.destroy(r.object);
+                ++freed;
+            } else {
+                retired[kept++] = r;
+            }
+        }
+        retired.resize(kept);
+        return freed;
+    }
+
+    size_t pendingCount() const {
+        return retired.size();
+    }
+};
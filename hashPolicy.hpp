@@ -0,0 +1,121 @@
+#pragma once
+#include "blake2s.hpp"
+#include "blake3.hpp"
+#include "keccak.hpp"
+#include "sha256Batch.hpp"
+#include "sha512.hpp"
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  Hash policies for SparseMerkleTree
+// ============================================================
+//
+// A policy is a stateless struct of static functions, passed as a template
+// argument so every call is resolved (and usually inlined) at compile time:
+//
+//   hashLeaf(value)          digest of a leaf value
+//   hashChildren(l, r)       digest of an interior node
+//   hashChildrenBatch(j, n)  n independent interior nodes
+//   batchWidth()             jobs worth grouping per batch call
+//
+// All policies produce 32-byte digests, so trees differ only in hash values.
+
+// Hashes a batch one job at a time for policies without a multi-lane kernel
+template <typename Policy>
+struct SingleLaneBatch {
+    static void hashChildrenBatch(const HashChildrenJob *jobs, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            *jobs[i].out = Policy::hashChildren(*jobs[i].left, *jobs[i].right);
+    }
+
+    static size_t batchWidth() {
+        return 1;
+    }
+};
+
+struct Sha256Hash {
+    static constexpr const char *name = "sha256";
+
+    static Digest hashLeaf(const string &value) {
+        return computeHash(value);
+    }
+
+    static Digest hashChildren(const Digest &left, const Digest &right) {
+        return ::hashChildren(left, right);
+    }
+
+    static void hashChildrenBatch(const HashChildrenJob *jobs, size_t n) {
+        ::hashChildrenBatch(jobs, n);
+    }
+
+    static size_t batchWidth() {
+        return hashChildrenBatchWidth();
+    }
+};
+
+struct Sha512_256Hash : SingleLaneBatch<Sha512_256Hash> {
+    static constexpr const char *name = "sha512/256";
+
+    static Digest hashLeaf(const string &value) {
+        return sha512_256Hash(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+    }
+
+    static Digest hashChildren(const Digest &left, const Digest &right) {
+        return sha512_256HashChildren(left, right);
+    }
+};
+
+struct Blake3Hash : SingleLaneBatch<Blake3Hash> {
+    static constexpr const char *name = "blake3";
+
+    static Digest hashLeaf(const string &value) {
+        return blake3Hash(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+    }
+
+    static Digest hashChildren(const Digest &left, const Digest &right) {
+        return blake3HashChildren(left, right);
+    }
+};
+
+struct Blake2sHash : SingleLaneBatch<Blake2sHash> {
+    static constexpr const char *name = "blake2s";
+
+    static Digest hashLeaf(const string &value) {
+        return blake2sHash(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+    }
+
+    static Digest hashChildren(const Digest &left, const Digest &right) {
+        return blake2sHashChildren(left, right);
+    }
+};
+
+struct Keccak256Hash : SingleLaneBatch<Keccak256Hash> {
+    static constexpr const char *name = "keccak256";
+
+    static Digest hashLeaf(const string &value) {
+        return keccak256Hash(reinterpret_cast<const uint8_t *>(value.data()), value.size());
+    }
+
+    static Digest hashChildren(const Digest &left, const Digest &right) {
+        return keccak256HashChildren(left, right);
+    }
+};
+
+// The empty-tree table shared by every tree and proof verifier (each keeps
+// it as default_hashes): result[h] is the root of an empty subtree of height
+// h, whose leaves all hold the hash of the empty value. Throws if depth is
+// outside [0, maxDepth], so this is also the one depth check they share.
+template <typename HashPolicy>
+vector<Digest> defaultHashes(int depth, int maxDepth) {
+    if (depth < 0 || depth > maxDepth)
+        throw runtime_error("Tree depth must be between 0 and " + to_string(maxDepth));
+    vector<Digest> table(depth + 1);
+    table[0] = HashPolicy::hashLeaf("");
+    for (int h = 1; h <= depth; ++h)
+        table[h] = HashPolicy::hashChildren(table[h - 1], table[h - 1]);
+    return table;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "digest.hpp"
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// ============================================================
+//  Keccak-256 (original Keccak padding, as used by Ethereum)
+// ============================================================
+//
+// Sponge over Keccak-f[1600] with a 136-byte rate. A 64-byte parent message
+// plus padding fits inside one rate block: one permutation per parent.
+
+static constexpr size_t KECCAK256_RATE = 136;
+
+static constexpr uint64_t KECCAK_ROUND_CONSTANTS[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL};
+
+// rho and pi folded together: walking lane 1 through the pi permutation,
+// each visited lane and the rotation it receives
+static constexpr int KECCAK_PI_LANE[24] = {
+    10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+static constexpr int KECCAK_RHO_OFFSET[24] = {
+    1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+
+static inline uint64_t rotl64(uint64_t x, int n) {
+    return (x << n) | (x >> (64 - n));
+}
+
+static void keccakF1600(uint64_t a[25]) {
+    uint64_t c[5];
+    for (int round = 0; round < 24; ++round) {
+        // theta
+#pragma GCC unroll 5
+        for (int x = 0; x < 5; ++x)
+            c[x] = a[x] ^ a[x + 5] ^ a[x + 10] ^ a[x + 15] ^ a[x + 20];
+#pragma GCC unroll 5
+        for (int x = 0; x < 5; ++x) {
+            uint64_t d = c[(x + 4) % 5] ^ rotl64(c[(x + 1) % 5], 1);
+            for (int y = 0; y < 25; y += 5)
+                a[y + x] ^= d;
+        }
+
+        // rho and pi
+        uint64_t carried = a[1];
+#pragma GCC unroll 24
+        for (int i = 0; i < 24; ++i) {
+            int lane = KECCAK_PI_LANE[i];
+            uint64_t next = a[lane];
+            a[lane] = rotl64(carried, KECCAK_RHO_OFFSET[i]);
+            carried = next;
+        }
+
+        // chi
+#pragma GCC unroll 5
+        for (int y = 0; y < 25; y += 5) {
+#pragma GCC unroll 5
+            for (int x = 0; x < 5; ++x)
+                c[x] = a[y + x];
+#pragma GCC unroll 5
+            for (int x = 0; x < 5; ++x)
+                a[y + x] = c[x] ^ (~c[(x + 1) % 5] & c[(x + 2) % 5]);
+        }
+
+        // iota
+        a[0] ^= KECCAK_ROUND_CONSTANTS[round];
+    }
+}
+
+static void keccakAbsorb(uint64_t a[25], const uint8_t block[KECCAK256_RATE]) {
+    for (size_t i = 0; i < KECCAK256_RATE / 8; ++i) {
+        uint64_t lane = 0;
+        for (int j = 7; j >= 0; --j)
+            lane = (lane << 8) | block[8 * i + j];
+        a[i] ^= lane;
+    }
+    keccakF1600(a);
+}
+
+static Digest keccak256Finish(const uint64_t a[25]) {
+    Digest result;
+    for (size_t i = 0; i < Digest::SIZE; ++i)
+        result.bytes[i] = uint8_t(a[i / 8] >> (8 * (i % 8)));
+    return result;
+}
+
+Digest keccak256Hash(const uint8_t *data, size_t length) {
+    uint64_t a[25] = {};
+
+    size_t offset = 0;
+    while (length - offset >= KECCAK256_RATE) {
+        keccakAbsorb(a, data + offset);
+        offset += KECCAK256_RATE;
+    }
+
+    uint8_t block[KECCAK256_RATE] = {};
+    memcpy(block, data + offset, length - offset);
+    block[length - offset] ^= 0x01;
+    block[KECCAK256_RATE - 1] ^= 0x80;
+    keccakAbsorb(a, block);
+
+    return keccak256Finish(a);
+}
+
+Digest keccak256HashChildren(const Digest &left, const Digest &right) {
+    uint64_t a[25] = {};
+
+    uint8_t block[KECCAK256_RATE] = {};
+    memcpy(block, left.bytes, Digest::SIZE);
+    memcpy(block + Digest::SIZE, right.bytes, Digest::SIZE);
+    block[2 * Digest::SIZE] = 0x01;
+    block[KECCAK256_RATE - 1] = 0x80;
+    keccakAbsorb(a, block);
+
+    return keccak256Finish(a);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "bitKey.hpp"
+#include "hashPolicy.hpp"
+#include "workerPool.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  Batch paths: locating leaves, rehashing level by level
+// ============================================================
+
+// Leaves of the sorted, distinct keys of updates, found serially (a sparse
+// tree allocates the missing paths here, so no worker ever races on them).
+// Keys without a leaf are dropped from updates, leaving result[i] the leaf of
+// updates[i].
+template <typename TreeType>
+vector<typename TreeType::NodeTypeAlias *> locateLeaves(TreeType &tree, vector<pair<BitKey, string>> &updates) {
+    using Node = typename TreeType::NodeTypeAlias;
+    vector<Node *> leaves;
+    leaves.reserve(updates.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < updates.size(); ++i) {
+        Node *leaf = tree.getOrCreateLeafNode(updates[i].first);
+        if (!leaf)
+            continue;
+        leaves.push_back(leaf);
+        if (kept != i)
+            updates[kept] = move(updates[i]);
+        ++kept;
+    }
+    updates.resize(kept);
+    return leaves;
+}
+
+// level holds distinct nodes of the given height in key order, with their
+// hashes final. Rehashes their ancestors one height at a time up to
+// toHeight, leaving level holding the ancestors at toHeight. Siblings are
+// adjacent in key order, so each parent is named (and hashed) once; the
+// parents of a height are independent and go through hashChildrenBatch,
+// split across pool (nullptr: the calling thread) when there are enough.
+// No node locks are taken.
+template <typename TreeType>
+void hashLevelsUp(TreeType &tree, vector<typename TreeType::NodeTypeAlias *> &level, int height, int toHeight,
+                  WorkerPool *pool = nullptr, int threads = 1) {
+    using Node = typename TreeType::NodeTypeAlias;
+    vector<Node *> parents;
+    vector<HashChildrenJob> jobs;
+    for (; height < toHeight; ++height) {
+        const Digest &emptySubtree = tree.getDefaultHash(height);
+        parents.clear();
+        jobs.clear();
+        for (Node *child : level) {
+            Node *parent = static_cast<Node *>(child->parent);
+            if (!parents.empty() && parents.back() == parent)
+                continue;
+            parents.push_back(parent);
+            jobs.push_back({parent->left ? &parent->left->hash : &emptySubtree,
+                            parent->right ? &parent->right->hash : &emptySubtree,
+                            &parent->hash});
+        }
+        parallelRanges(pool, threads, jobs.size(), [&](size_t begin, size_t end) {
+            TreeType::Hash::hashChildrenBatch(jobs.data() + begin, end - begin);
+        });
+        level.swap(parents);
+    }
+}
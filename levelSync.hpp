@@ -0,0 +1,71 @@
+#pragma once
+#include "merkleTree.hpp"
+#include "workerPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// ============================================================
+//  LevelSyncAlgorithm: level-synchronous batch updates
+// ============================================================
+//
+// Instead of percolating each update on its own, the batch is swept up the
+// tree one height at a time. The sorted keys give the dirty nodes of a
+// height directly (siblings are adjacent, so a parent is named once), and
+// each dirty node is hashed exactly once, after both its children are final.
+// The parents of one height are independent: they are split into contiguous
+// ranges across the workers and hashed with the multi-lane batch kernel, and
+// the end of a dispatch is the barrier before the next height.
+//
+// No node locks are taken, so a batch must not overlap other writers or
+// readers of the same tree; run it between live phases, like a bulk load.
+
+class LevelSyncAlgorithm {
+public:
+    LevelSyncAlgorithm() = default;
+
+    // Runs batches on a caller-owned pool; see AngelaAlgorithm
+    explicit LevelSyncAlgorithm(WorkerPool &executor) : pool(executor) {}
+
+    // Applies the batch (last value wins for a repeated key) and returns the
+    // time spent hashing in milliseconds
+    template <typename TreeType>
+    long long processBatch(
+        TreeType &tree,
+        const vector<pair<BitKey, string>> &updates_in,
+        int numThreads) {
+        using Node = typename TreeType::NodeTypeAlias;
+        using Hash = typename TreeType::Hash;
+
+        vector<pair<BitKey, string>> updates = updates_in;
+        last_coalesced = coalesceByKey(updates);
+        if (updates.empty())
+            return 0;
+
+        vector<Node *> level = locateLeaves(tree, updates);
+        if (level.empty())
+            return 0;
+
+        WorkerPool &executor = pool.get(numThreads);
+        auto startTime = chrono::high_resolution_clock::now();
+
+        parallelRanges(&executor, numThreads, level.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                level[i]->hash = Hash::hashLeaf(updates[i].second);
+        });
+        hashLevelsUp(tree, level, 0, tree.getDepth(), &executor, numThreads);
+
+        auto endTime = chrono::high_resolution_clock::now();
+        return chrono::duration_cast<chrono::milliseconds>(endTime - startTime).count();
+    }
+
+    // coalesceByKey's count for the last batch
+    size_t getLastCoalescedCount() const {
+        return last_coalesced;
+    }
+
+private:
+    LazyWorkerPool pool;
+    size_t last_coalesced = 0;
+};
@@ -0,0 +1,164 @@
+#pragma once
+#include "liveUpdates.hpp"
+#include "utils.hpp"
+#include "workLoad.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  LiveThreadPool: replays a workload through a live algorithm
+// ============================================================
+//
+// Requests are queued as they arrive and applied by numThreads workers, each
+// recording the response time (finish minus arrival) of what it completes.
+// Updates to the same key are coalesced on the way in (see PendingKey), so a
+// hot key costs one tree update per burst rather than one per write.
+
+template <typename TreeType, typename Algo>
+class LiveThreadPool {
+public:
+    TreeType &tree;
+    Algo &algo;
+    long long playback_start_time = 0;
+    int numThreads;
+    atomic<bool> stop{false};
+    queue<WorkloadEvent> q;
+    mutex q_mtx;
+    condition_variable cv;
+    vector<thread> workers;
+
+    vector<vector<long long>> response_times_per_thread;
+    static thread_local int update_counter;
+
+    // Last-writer-wins coalescing, guarded by q_mtx. Per key, at most one
+    // update is queued and at most one is being applied. A newer update for
+    // a queued key just replaces its value; one for a key being applied waits
+    // as `deferred` and the same worker applies it next, so updates to a key
+    // never race and the newest value is the one left in the tree. Absorbed
+    // updates complete (for response times) with the one that absorbed them.
+    struct PendingKey {
+        WorkloadEvent *queued = nullptr; // element of q
+        vector<long long> queued_absorbed;
+        bool running = false;
+        bool has_deferred = false;
+        WorkloadEvent deferred;
+        vector<long long> deferred_absorbed;
+    };
+    unordered_map<BitKey, PendingKey> pending;
+    size_t coalesced = 0; // updates absorbed by a newer one
+
+    LiveThreadPool(TreeType &t, Algo &a, int threads)
+        : tree(t), algo(a), numThreads(threads) {
+        response_times_per_thread.resize(threads);
+        workers.reserve(threads);
+        for (int i = 0; i < threads; i++)
+            workers.emplace_back(&LiveThreadPool::worker, this, i);
+    }
+
+    ~LiveThreadPool() {
+        {
+            lock_guard<mutex> lk(q_mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &w : workers)
+            if (w.joinable())
+                w.join();
+    }
+
+    void enqueue(const OperationRequest &op, long long arrival_us) {
+        lock_guard<mutex> lk(q_mtx);
+        if (op.op_type == UPDATE) {
+            PendingKey &state = pending[op.key];
+            if (state.queued) {
+                state.queued->op.value = op.value;
+                state.queued_absorbed.push_back(arrival_us);
+                ++coalesced;
+                return;
+            }
+            if (state.running) {
+                if (state.has_deferred) {
+                    state.deferred_absorbed.push_back(state.deferred.arrival_us);
+                    ++coalesced;
+                }
+                state.deferred = {op, arrival_us};
+                state.has_deferred = true;
+                return;
+            }
+            q.push({op, arrival_us});
+            state.queued = &q.back(); // deque storage: stable until popped
+        } else {
+            q.push({op, arrival_us});
+        }
+        cv.notify_one();
+    }
+
+    // After applying an update: hands over the key's deferred update, if
+    // any, or releases the key
+    bool takeDeferred(WorkloadEvent &job, vector<long long> &absorbed) {
+        lock_guard<mutex> lk(q_mtx);
+        auto it = pending.find(job.op.key);
+        if (!it->second.has_deferred) {
+            pending.erase(it);
+            return false;
+        }
+        job = move(it->second.deferred);
+        absorbed = move(it->second.deferred_absorbed);
+        it->second.deferred_absorbed.clear();
+        it->second.has_deferred = false;
+        return true;
+    }
+
+    void worker(int tid) {
+        while (true) {
+            WorkloadEvent job;
+            vector<long long> absorbed;
+
+            // wait for job
+            {
+                unique_lock<mutex> lk(q_mtx);
+                cv.wait(lk, [&] { return stop || !q.empty(); });
+                if (stop && q.empty())
+                    return;
+
+                job = q.front();
+                q.pop();
+                if (job.op.op_type == UPDATE) {
+                    PendingKey &state = pending[job.op.key];
+                    state.queued = nullptr;
+                    state.running = true;
+                    absorbed.swap(state.queued_absorbed);
+                }
+            }
+
+            do {
+                if (job.op.op_type == UPDATE) {
+                    update_counter++;
+                    ThreadUpdateId id(tid);
+                    id.update_count = update_counter;
+                    algo.update(tree, job.op.key, job.op.value, id);
+                } else if (job.op.op_type == READ_ROOT) {
+                    tree.getRootHash();
+                } else if (job.op.op_type == READ_LEAF) {
+                    tree.getLeafNode(job.op.key);
+                }
+
+                long long finish_us = now_us() - playback_start_time;
+                response_times_per_thread[tid].push_back(finish_us - job.arrival_us);
+                for (long long arrival_us : absorbed)
+                    response_times_per_thread[tid].push_back(finish_us - arrival_us);
+                absorbed.clear();
+            } while (job.op.op_type == UPDATE && takeDeferred(job, absorbed));
+        }
+    }
+};
+
+template <typename T, typename A>
+thread_local int LiveThreadPool<T, A>::update_counter = 0;
@@ -18,50 +18,56 @@ struct ThreadUpdateId {
 };
 
 // Structure for MerkleTree nodes
-struct LiveUpdatesNode : public MerkleNode {
+template <typename Lock = mutex>
+struct BasicLiveUpdatesNode : public BasicMerkleNode<Lock> {
     ThreadUpdateId last_updated_thread_index;
     ThreadUpdateId left_child_thread_index;
     ThreadUpdateId right_child_thread_index;
 
-    LiveUpdatesNode(bool leaf = false)
-        : MerkleNode(leaf), last_updated_thread_index(), left_child_thread_index(), right_child_thread_index() {}
+    BasicLiveUpdatesNode(bool leaf = false)
+        : BasicMerkleNode<Lock>(leaf), last_updated_thread_index(), left_child_thread_index(), right_child_thread_index() {}
 };
 
+using LiveUpdatesNode = BasicLiveUpdatesNode<>;
+
 class LiveAlgorithm {
 public:
     /**
      * Update a single leaf and percolate the hash up using the "live" parallel logic.
      *
      * Requirements:
-     *  - TreeType::NodeType inherits from MerkleNode
+     *  - TreeType::NodeType inherits from BasicMerkleNode<Lock>
      *  - NodeType contains:
      *        last_updated_thread_index
      *        left_child_thread_index
      *        right_child_thread_index
      *        hash
      *        parent, left, right pointers
-     *        node_mutex
-     *  - TreeType must implement getDepth(), getLeafNode(key), getRoot()
+     *        node_mutex (any BasicLockable, see nodeLock.hpp)
+     *  - TreeType must implement getDepth(), getOrCreateLeafNode(key), getRoot(),
+     *    getDefaultHash(height)
+     *  - TreeType::Hash is the tree's hash policy
      */
     template <typename TreeType>
-    void update(TreeType &tree, const string &key, const string &value, ThreadUpdateId incoming_req) {
+    void update(TreeType &tree, const BitKey &key, const string &value, ThreadUpdateId incoming_req) {
         using Node = typename TreeType::NodeTypeAlias;
+        using Hash = typename TreeType::Hash;
 
         // Validate key length against tree depth
         int depth = tree.getDepth();
-        if ((int)key.length() != depth) {
+        if (key.size() != depth) {
             throw runtime_error("Invalid key length");
         }
 
-        // Locate leaf node via tree API
-        Node *current = static_cast<Node *>(tree.getLeafNode(key));
+        // Locate leaf node via tree API (allocating its path in a sparse tree)
+        Node *current = static_cast<Node *>(tree.getOrCreateLeafNode(key));
         if (!current) {
-            throw runtime_error("Leaf node not found for key: " + key);
+            throw runtime_error("Leaf node not found for key: " + key.toString());
         }
 
         // Update the leaf under its lock
         {
-            lock_guard<mutex> lock(current->node_mutex);
+            lock_guard lock(current->node_mutex);
             if (!current->is_leaf) {
                 throw runtime_error("Reached non-leaf node while updating leaf");
             }
@@ -83,22 +89,22 @@ public:
                 }
             }
 
-            current->hash = computeHash(value);
+            current->hash = Hash::hashLeaf(value);
             current->last_updated_thread_index = incoming_req;
         }
 
         // Percolate upwards
         Node *root = static_cast<Node *>(tree.getRoot());
-        while (current != root) {
+        for (int height = 0; current != root; ++height) {
 
-            string leftHash = "", rightHash = "";
+            Digest leftHash, rightHash;
             ThreadUpdateId left_updated_by, right_updated_by;
             Node *parent = static_cast<Node *>(current->parent);
             if (!parent)
                 break;
 
             // Acquire parent lock first
-            lock_guard<mutex> parent_lock(parent->node_mutex);
+            lock_guard parent_lock(parent->node_mutex);
 
             // Check stop condition for this thread
             if (incoming_req.thread_index >= 0 &&
@@ -121,13 +127,20 @@ public:
                 }
             }
 
+            // A missing child (sparse mode) is an empty subtree of our height
             {
-                lock_guard<mutex> leftChildLock(left->node_mutex);
-                lock_guard<mutex> rightChildLock(right->node_mutex);
-                leftHash = left->hash;
-                left_updated_by = left->last_updated_thread_index;
-                rightHash = right->hash;
-                right_updated_by = right->last_updated_thread_index;
+                unique_lock<typename Node::LockType> leftChildLock, rightChildLock;
+                leftHash = rightHash = tree.getDefaultHash(height);
+                if (left) {
+                    leftChildLock = unique_lock(left->node_mutex);
+                    leftHash = left->hash;
+                    left_updated_by = left->last_updated_thread_index;
+                }
+                if (right) {
+                    rightChildLock = unique_lock(right->node_mutex);
+                    rightHash = right->hash;
+                    right_updated_by = right->last_updated_thread_index;
+                }
             }
 
             // If parent was updated by another thread, mark it to stop
@@ -143,7 +156,7 @@ public:
             }
 
             // Recompute parent hash and update metadata
-            parent->hash = computeHash(leftHash + rightHash);
+            parent->hash = Hash::hashChildren(leftHash, rightHash);
             parent->left_child_thread_index = left_updated_by;
             parent->right_child_thread_index = right_updated_by;
             parent->last_updated_thread_index = incoming_req;
@@ -0,0 +1,226 @@
+#pragma once
+#include "bitKey.hpp"
+#include "digest.hpp"
+#include "hashPolicy.hpp"
+#include <bitset>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  Inclusion proofs
+// ============================================================
+//
+// Siblings are listed from the leaf upwards. An empty-subtree sibling is not
+// sent: its bit is set in the default bitmap and the verifier takes the hash
+// from its own default table, so proofs for a sparse tree stay short.
+
+struct MerkleProof {
+    BitKey key;
+    bitset<BitKey::MAX_BITS> default_siblings; // bit h: sibling at height h is empty
+    vector<Digest> siblings;                   // the others, lowest first
+};
+
+// Proof that key is absent, i.e. its leaf holds the default hash. The key's
+// path enters an empty subtree at empty_height, so only the siblings above
+// that point are listed; below it every hash follows from the default table.
+struct NonMembershipProof {
+    BitKey key;
+    int empty_height;
+    bitset<BitKey::MAX_BITS> default_siblings; // heights >= empty_height only
+    vector<Digest> siblings;                   // the others, lowest first
+};
+
+// One proof for a set of keys. Siblings that are themselves on a proven path
+// are left out, so each needed node appears once. Verification visits the
+// needed siblings height by height (leaves first) and, within a height, in
+// key order; both lists below follow that order.
+struct MerkleMultiProof {
+    vector<BitKey> keys;           // sorted, distinct
+    vector<bool> default_siblings; // one per needed sibling
+    vector<Digest> siblings;       // the non-default ones
+};
+
+// ============================================================
+//  ProofVerifier: recomputes roots from proofs
+// ============================================================
+//
+// Needs only the tree depth and hash policy, not the tree. Work is done a
+// height at a time: every parent digest of one height is independent of the
+// others, so a height is a single hashChildrenBatch call, which the SHA-256
+// policy spreads over the multi-lane kernel. A malformed proof (wrong key
+// length, too few or too many siblings) never verifies.
+
+template <typename HashPolicy = Sha256Hash>
+class ProofVerifier {
+private:
+    int depth;
+    vector<Digest> default_hashes;
+
+    // Lets one proof be verified through the batch path without copying it
+    template <typename T>
+    struct Span {
+        const T *data;
+        size_t size;
+    };
+
+    vector<bool> verifyProofs(const Digest &root, Span<MerkleProof> proofs, Span<Digest> leafHashes) const {
+        if (leafHashes.size != proofs.size)
+            throw runtime_error("Each proof needs one leaf hash");
+
+        // Malformed proofs drop out up front; next[i] indexes the next
+        // non-default sibling of proof i
+        size_t n = proofs.size;
+        vector<bool> valid(n);
+        vector<size_t> next(n);
+        for (size_t i = 0; i < n; ++i) {
+            const MerkleProof &proof = proofs.data[i];
+            valid[i] = proof.key.size() == depth &&
+                       proof.siblings.size() + proof.default_siblings.count() == size_t(depth) &&
+                       (proof.default_siblings >> depth).none();
+        }
+
+        vector<Digest> hashes(leafHashes.data, leafHashes.data + n), parents(n);
+        vector<HashChildrenJob> jobs;
+        jobs.reserve(n);
+        for (int height = 0; height < depth; ++height) {
+            const Digest &emptySubtree = default_hashes[height];
+            jobs.clear();
+            for (size_t i = 0; i < n; ++i) {
+                if (!valid[i])
+                    continue;
+                const MerkleProof &proof = proofs.data[i];
+                const Digest *other = proof.default_siblings[height] ? &emptySubtree : &proof.siblings[next[i]++];
+                if (proof.key.bit(depth - height - 1))
+                    jobs.push_back({other, &hashes[i], &parents[i]});
+                else
+                    jobs.push_back({&hashes[i], other, &parents[i]});
+            }
+            HashPolicy::hashChildrenBatch(jobs.data(), jobs.size());
+            hashes.swap(parents);
+        }
+
+        for (size_t i = 0; i < n; ++i)
+            valid[i] = valid[i] && hashes[i] == root;
+        return valid;
+    }
+
+    // Root implied by a multiproof and the leaf hashes of its keys; false if
+    // the proof is malformed
+    bool multiRoot(const MerkleMultiProof &proof, vector<Digest> hashes, Digest &root) const {
+        if (hashes.size() != proof.keys.size())
+            throw runtime_error("Each key needs one leaf hash");
+        if (proof.keys.empty())
+            return false;
+        for (size_t i = 0; i < proof.keys.size(); ++i)
+            if (proof.keys[i].size() != depth || (i > 0 && !(proof.keys[i - 1] < proof.keys[i])))
+                return false;
+
+        // Each node of the current height is named by one leaf key below it
+        vector<const BitKey *> paths, parentPaths;
+        for (const BitKey &key : proof.keys)
+            paths.push_back(&key);
+        vector<Digest> parents;
+        vector<HashChildrenJob> jobs;
+        size_t flag = 0, sibling = 0;
+
+        for (int height = 0; height < depth; ++height) {
+            int level = depth - height; // bits that name a node of this height
+            const Digest &emptySubtree = default_hashes[height];
+
+            parentPaths.clear();
+            parents.resize(paths.size());
+            jobs.clear();
+            for (size_t i = 0; i < paths.size(); ++i) {
+                Digest *out = &parents[parentPaths.size()];
+                parentPaths.push_back(paths[i]);
+
+                // Two proven siblings are adjacent in key order
+                if (i + 1 < paths.size() && paths[i]->commonPrefixLength(*paths[i + 1]) >= level - 1) {
+                    jobs.push_back({&hashes[i], &hashes[i + 1], out});
+                    ++i;
+                    continue;
+                }
+                if (flag == proof.default_siblings.size())
+                    return false;
+                const Digest *other = &emptySubtree;
+                if (!proof.default_siblings[flag++]) {
+                    if (sibling == proof.siblings.size())
+                        return false;
+                    other = &proof.siblings[sibling++];
+                }
+                if (paths[i]->bit(level - 1))
+                    jobs.push_back({other, &hashes[i], out});
+                else
+                    jobs.push_back({&hashes[i], other, out});
+            }
+            HashPolicy::hashChildrenBatch(jobs.data(), jobs.size());
+
+            parents.resize(parentPaths.size());
+            hashes.swap(parents);
+            paths.swap(parentPaths);
+        }
+        if (flag != proof.default_siblings.size() || sibling != proof.siblings.size())
+            return false;
+        root = hashes[0];
+        return true;
+    }
+
+public:
+    explicit ProofVerifier(int tree_depth) : depth(tree_depth) {
+        default_hashes = defaultHashes<HashPolicy>(tree_depth, BitKey::MAX_BITS);
+    }
+
+    int getDepth() const {
+        return depth;
+    }
+
+    // Single proof; leafHash is HashPolicy::hashLeaf of the claimed value
+    bool verify(const Digest &root, const MerkleProof &proof, const Digest &leafHash) const {
+        return verifyProofs(root, {&proof, 1}, {&leafHash, 1})[0];
+    }
+
+    bool verify(const Digest &root, const MerkleProof &proof, const string &value) const {
+        return verify(root, proof, HashPolicy::hashLeaf(value));
+    }
+
+    bool verifyNonMembership(const Digest &root, const NonMembershipProof &proof) const {
+        int empty = proof.empty_height;
+        if (proof.key.size() != depth || empty < 0 || empty > depth ||
+            proof.siblings.size() + proof.default_siblings.count() != size_t(depth - empty) ||
+            (proof.default_siblings >> depth).any() ||
+            (proof.default_siblings << (BitKey::MAX_BITS - empty)).any())
+            return false;
+
+        Digest hash = default_hashes[empty];
+        size_t next = 0;
+        for (int height = empty; height < depth; ++height) {
+            const Digest &other = proof.default_siblings[height] ? default_hashes[height] : proof.siblings[next++];
+            hash = proof.key.bit(depth - height - 1) ? HashPolicy::hashChildren(other, hash)
+                                                     : HashPolicy::hashChildren(hash, other);
+        }
+        return hash == root;
+    }
+
+    // Many independent proofs against one root, all advanced together one
+    // height at a time; result[i] tells whether proofs[i] holds leafHashes[i]
+    vector<bool> verifyBatch(const Digest &root, const vector<MerkleProof> &proofs,
+                             const vector<Digest> &leafHashes) const {
+        return verifyProofs(root, {proofs.data(), proofs.size()}, {leafHashes.data(), leafHashes.size()});
+    }
+
+    bool verifyMulti(const Digest &root, const MerkleMultiProof &proof, const vector<Digest> &leafHashes) const {
+        Digest computed;
+        return multiRoot(proof, leafHashes, computed) && computed == root;
+    }
+
+    // values[i] is the claimed value of proof.keys[i] (keys are sorted)
+    bool verifyMulti(const Digest &root, const MerkleMultiProof &proof, const vector<string> &values) const {
+        vector<Digest> leafHashes;
+        leafHashes.reserve(values.size());
+        for (const string &value : values)
+            leafHashes.push_back(HashPolicy::hashLeaf(value));
+        return verifyMulti(root, proof, leafHashes);
+    }
+};
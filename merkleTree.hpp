@@ -1,4 +1,11 @@
 #pragma once
+#include "bitKey.hpp"
+#include "hashPolicy.hpp"
+#include "levelHash.hpp"
+#include "merkleProof.hpp"
+#include "nodeArena.hpp"
+#include "nodeLock.hpp"
+#include <algorithm>
 #include <atomic>
 #include <bitset>
 #include <chrono>
@@ -8,9 +15,9 @@
 #include <fstream>
 #include <iostream>
 #include <mutex>
-#include <openssl/sha.h>
 #include <queue>
 #include <random>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
 #include <thread>
@@ -24,73 +31,274 @@ using namespace std;
 static constexpr int MAX_THREADS = 64; // Fixed size for stop_vector
 static vector<atomic<int>> stop_vector(MAX_THREADS);
 
-// Hash function using SHA256
-string computeHash(const string &data) {
-    unsigned char hash[SHA256_DIGEST_LENGTH];
-    SHA256(reinterpret_cast<const unsigned char *>(data.c_str()), data.length(), hash);
-    string result;
-    for (int i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
-        char buf[3];
-        snprintf(buf, sizeof(buf), "%02x", hash[i]);
-        result += buf;
-    }
-    return result;
-}
+// Structure for MerkleTree nodes; storage is owned by the tree's NodeArena,
+// so nodes are never deleted individually. A node does not store its path:
+// callers derive it from the leaf key and the level they are at.
+// Lock is the node lock policy (see nodeLock.hpp).
+template <typename Lock = mutex>
+struct BasicMerkleNode {
+    using LockType = Lock;
 
-// Structure for MerkleTree nodes
-struct MerkleNode {
-    string hash;
-    MerkleNode *left;
-    MerkleNode *right;
-    MerkleNode *parent;
+    Digest hash;
+    BasicMerkleNode *left;
+    BasicMerkleNode *right;
+    BasicMerkleNode *parent;
     bool is_leaf;
-    mutex node_mutex;
-    string key;
-
-    MerkleNode(bool leaf = false)
-        : hash(), left(nullptr), right(nullptr), parent(nullptr), is_leaf(leaf), key("") {}
+    Lock node_mutex;
 
-    ~MerkleNode() {
-        delete left;
-        delete right;
-    }
+    BasicMerkleNode(bool leaf = false)
+        : hash(), left(nullptr), right(nullptr), parent(nullptr), is_leaf(leaf) {}
 };
 
-template <typename NodeType>
+using MerkleNode = BasicMerkleNode<>;
+
+// Complete: every leaf and interior node is allocated up front.
+// Sparse:   only nodes on paths to written leaves exist; a missing child is
+//           an empty subtree whose hash comes from the per-height default table.
+enum class TreeMode { Complete,
+                      Sparse };
+
+// HashPolicy selects the hash function at compile time (see hashPolicy.hpp)
+template <typename NodeType, typename HashPolicy = Sha256Hash>
 class SparseMerkleTree {
 public:
     using Node = NodeType;
     using NodeTypeAlias = NodeType;
+    using Hash = HashPolicy;
 
 private:
+    NodeArena<NodeType> arena; // declared first: released after everything else
     NodeType *root;
     int depth;
-    string default_leaf_hash;
-    unordered_map<string, NodeType *> leaf_nodes;
+    TreeMode mode;
+    Digest default_leaf_hash;
+    vector<Digest> default_hashes;
+    unordered_map<BitKey, NodeType *> leaf_nodes; // sparse mode
+    vector<NodeType *> leaf_index;                // complete mode, indexed by key
+
+    // Sparse mode only: held shared for leaf lookups, exclusively while nodes
+    // are being created. Child pointers are additionally written under the
+    // parent's node_mutex, since percolating threads read them under that lock.
+    mutable shared_mutex structure_mutex;
+
+    NodeType *findLeaf(const BitKey &key) const {
+        if (mode == TreeMode::Complete)
+            return key.size() == depth ? leaf_index[key.toIndex()] : nullptr;
+        auto it = leaf_nodes.find(key);
+        if (it == leaf_nodes.end())
+            return nullptr;
+        return it->second;
+    }
+
+    // A subtree deferred to a worker thread during parallel construction
+    struct BuildTask {
+        NodeType *slot;
+        NodeType *parent;
+        uint64_t index;
+    };
+
+    // Constructs the complete subtree of height d in preorder into the
+    // 2^(d+1) - 1 slots starting at slot; index is the subtree root's position
+    // within its level. An empty tree holds only default hashes, so nothing is
+    // hashed. With tasks given, subtrees of height split_height are queued
+    // there instead of being built.
+    NodeType *buildCompleteTree(NodeType *slot, int d, NodeType *parent, uint64_t index,
+                                int split_height, vector<BuildTask> *tasks) {
+        if (tasks && d == split_height) {
+            tasks->push_back({slot, parent, index});
+            return slot;
+        }
 
-    NodeType *buildCompleteTree(int d, NodeType *parent, string prefix) {
-        NodeType *node = new NodeType(d == 0);
-        node->key = prefix;
+        NodeType *node = new (slot) NodeType(d == 0);
         node->parent = parent;
+        node->hash = default_hashes[d];
 
         if (d == 0) {
-            node->hash = default_leaf_hash;
-            leaf_nodes[prefix] = node;
+            leaf_index[index] = node;
             return node;
         }
-        node->left = buildCompleteTree(d - 1, node, prefix + "0");
-        node->right = buildCompleteTree(d - 1, node, prefix + "1");
-        node->hash = computeHash(node->left->hash + node->right->hash);
+        node->left = buildCompleteTree(slot + 1, d - 1, node, 2 * index, split_height, tasks);
+        node->right = buildCompleteTree(slot + (size_t(1) << d), d - 1, node, 2 * index + 1, split_height, tasks);
         return node;
     }
 
+    // Top levels serially, then equal subtrees claimed by the workers. Every
+    // node has a fixed slot, so workers never share arena or leaf_index state.
+    void buildComplete(int threads) {
+        NodeType *slots = arena.allocateBlock((size_t(2) << depth) - 1);
+        leaf_index.resize(size_t(1) << depth);
+
+        if (threads <= 1 || depth < PARALLEL_BUILD_MIN_DEPTH) {
+            root = buildCompleteTree(slots, depth, nullptr, 0, -1, nullptr);
+            return;
+        }
+
+        // A few subtrees per thread so that uneven scheduling still balances
+        int top_levels = 1;
+        while (top_levels < depth && (1 << top_levels) < 4 * threads)
+            ++top_levels;
+        int split_height = depth - top_levels;
+
+        vector<BuildTask> tasks;
+        root = buildCompleteTree(slots, depth, nullptr, 0, split_height, &tasks);
+
+        atomic<size_t> next(0);
+        vector<thread> workers;
+        workers.reserve(threads);
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                for (size_t i; (i = next.fetch_add(1)) < tasks.size();)
+                    buildCompleteTree(tasks[i].slot, split_height, tasks[i].parent, tasks[i].index, -1, nullptr);
+            });
+        }
+        for (auto &w : workers)
+            w.join();
+    }
+
+    // Sparse bulk load: allocates the leaves of the sorted, distinct keys and
+    // every ancestor bottom-up, attaching the top level to the existing root.
+    // Returns the leaves in key order; no hashing happens here.
+    vector<NodeType *> materialiseSorted(const vector<pair<BitKey, string>> &entries) {
+        if (depth == 0) {
+            leaf_nodes[BitKey()] = root;
+            return {root};
+        }
+
+        vector<NodeType *> leaves;
+        leaves.reserve(entries.size());
+        leaf_nodes.reserve(entries.size());
+        for (const auto &entry : entries) {
+            NodeType *leaf = arena.create(true);
+            leaf->hash = default_leaf_hash;
+            leaves.push_back(leaf);
+            leaf_nodes[entry.first] = leaf;
+        }
+
+        // Sorted children sharing a parent are adjacent. Each node at level l
+        // carries the key of one leaf below it (paths[i]), whose first l bits
+        // are the node's path.
+        vector<NodeType *> level = leaves, parents;
+        vector<const BitKey *> paths(entries.size()), parentPaths;
+        for (size_t i = 0; i < entries.size(); ++i)
+            paths[i] = &entries[i].first;
+
+        for (int l = depth; l > 0; --l) {
+            parents.clear();
+            parentPaths.clear();
+            for (size_t i = 0; i < level.size(); ++i) {
+                const BitKey &path = *paths[i];
+                if (parents.empty() || parentPaths.back()->commonPrefixLength(path) < l - 1) {
+                    NodeType *parent = (l == 1) ? root : arena.create(false);
+                    parent->hash = default_hashes[depth - l + 1];
+                    parents.push_back(parent);
+                    parentPaths.push_back(&path);
+                }
+                NodeType *parent = parents.back();
+                level[i]->parent = parent;
+                (path.bit(l - 1) ? parent->right : parent->left) = level[i];
+            }
+            level.swap(parents);
+            paths.swap(parentPaths);
+        }
+        return leaves;
+    }
+
+    // Hash of a proof sibling at the given height; false if it is an empty
+    // subtree (missing, or still at its default hash)
+    bool readSibling(NodeType *node, int height, Digest &hash) const {
+        if (!node)
+            return false;
+        hash = readHash(node);
+        return hash != default_hashes[height];
+    }
+
+    // Collects, per height, the siblings needed to prove the sorted keys
+    // [begin, end) below node at level; node is null for an empty subtree.
+    // Visits each level left to right, which is the multiproof order.
+    void collectSiblings(NodeType *node, int level, const BitKey *begin, const BitKey *end,
+                         vector<vector<NodeType *>> &needed) const {
+        if (level == depth)
+            return;
+        const BitKey *mid = partition_point(begin, end, [level](const BitKey &k) { return !k.bit(level); });
+        NodeType *left = node ? static_cast<NodeType *>(node->left) : nullptr;
+        NodeType *right = node ? static_cast<NodeType *>(node->right) : nullptr;
+        int height = depth - level - 1;
+
+        if (begin == mid)
+            needed[height].push_back(left);
+        else
+            collectSiblings(left, level + 1, begin, mid, needed);
+        if (mid == end)
+            needed[height].push_back(right);
+        else
+            collectSiblings(right, level + 1, mid, end, needed);
+    }
+
 public:
-    SparseMerkleTree(int tree_depth)
-        : depth(tree_depth), default_leaf_hash(computeHash("")) {
-        root = buildCompleteTree(tree_depth, nullptr, "");
+    // Complete trees below this depth are built on the calling thread
+    static constexpr int PARALLEL_BUILD_MIN_DEPTH = 12;
+    // Deepest complete tree whose node count fits in 64 bits
+    static constexpr int MAX_COMPLETE_DEPTH = 62;
+
+    // huge_pages advises the node arena to back its slabs with huge pages;
+    // build_threads bounds complete-tree construction (0 = all hardware threads)
+    SparseMerkleTree(int tree_depth, TreeMode tree_mode = TreeMode::Complete, bool huge_pages = false,
+                     int build_threads = 0)
+        : arena(huge_pages), depth(tree_depth), mode(tree_mode) {
+        default_hashes = defaultHashes<HashPolicy>(tree_depth, BitKey::MAX_BITS);
+        default_leaf_hash = default_hashes[0];
+        if (mode == TreeMode::Complete && tree_depth > MAX_COMPLETE_DEPTH) {
+            throw runtime_error("Complete trees are limited to depth " + to_string(MAX_COMPLETE_DEPTH) +
+                                "; use TreeMode::Sparse");
+        }
+
+        if (mode == TreeMode::Sparse) {
+            root = arena.create(tree_depth == 0);
+            root->hash = default_hashes[tree_depth];
+            return;
+        }
+
+        if (build_threads <= 0)
+            build_threads = max(1u, thread::hardware_concurrency());
+        buildComplete(build_threads);
+    }
+
+    // Bulk load: builds the tree holding the given key/value pairs in one
+    // bottom-up pass, hashing each leaf and each populated interior node
+    // exactly once. Entries are sorted here if needed; for a repeated key the
+    // last value wins.
+    SparseMerkleTree(int tree_depth, vector<pair<BitKey, string>> entries, TreeMode tree_mode = TreeMode::Complete,
+                     bool huge_pages = false, int build_threads = 0)
+        : SparseMerkleTree(tree_depth, tree_mode, huge_pages, build_threads) {
+        if (build_threads <= 0)
+            build_threads = max(1u, thread::hardware_concurrency());
+
+        for (const auto &entry : entries)
+            if (entry.first.size() != depth)
+                throw runtime_error("Invalid key length");
+        coalesceByKey(entries);
+        if (entries.empty())
+            return;
+
+        vector<NodeType *> leaves;
+        if (mode == TreeMode::Sparse) {
+            leaves = materialiseSorted(entries);
+        } else {
+            leaves.resize(entries.size());
+            for (size_t i = 0; i < entries.size(); ++i)
+                leaves[i] = findLeaf(entries[i].first);
+        }
+
+        WorkerPool workers(build_threads);
+        parallelRanges(&workers, build_threads, leaves.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                leaves[i]->hash = HashPolicy::hashLeaf(entries[i].second);
+        });
+        hashLevelsUp(*this, leaves, 0, depth, &workers, build_threads);
     }
 
-    virtual ~SparseMerkleTree() { delete root; }
+    // Nodes go away with the arena in one release
+    virtual ~SparseMerkleTree() {}
 
     int getDepth() const {
         return depth;
@@ -101,54 +309,218 @@ public:
     }
 
     string getRootHash() const {
-        return root->hash;
+        return root->hash.toHex();
     }
 
     size_t getLeafCount() const {
-        return leaf_nodes.size();
+        return mode == TreeMode::Complete ? leaf_index.size() : leaf_nodes.size();
     }
 
-    NodeType *getLeafNode(const string &key) {
-        auto it = leaf_nodes.find(key);
-        if (it == leaf_nodes.end())
+    // Hash of a node, consistent with concurrent writers: read optimistically
+    // (never blocking a writer) for SeqLock nodes, under the node lock otherwise
+    static Digest readHash(NodeType *node) {
+        if constexpr (is_same<typename NodeType::LockType, SeqLock>::value) {
+            return optimisticRead(node->node_mutex, node->hash);
+        } else {
+            lock_guard lock(node->node_mutex);
+            return node->hash;
+        }
+    }
+
+    Digest readRootHash() {
+        return readHash(root);
+    }
+
+    // A leaf that was never written (sparse mode) reads as the default
+    Digest readLeafHash(const BitKey &key) {
+        NodeType *leaf = getLeafNode(key);
+        if (!leaf) {
+            if (key.size() != depth)
+                throw runtime_error("Invalid key length");
+            return default_leaf_hash;
+        }
+        return readHash(leaf);
+    }
+
+    TreeMode getMode() const {
+        return mode;
+    }
+
+    // Hash of an empty subtree whose root sits at the given height (leaves are 0)
+    const Digest &getDefaultHash(int height) const {
+        return default_hashes[height];
+    }
+
+    // Inclusion proof for the leaf at key; a leaf never written (sparse mode)
+    // is proven to hold the default leaf hash. Every sibling is read
+    // consistently, but a proof taken during concurrent updates may combine
+    // hashes from before and after some of them.
+    MerkleProof getProof(const BitKey &key) const {
+        if (key.size() != depth)
+            throw runtime_error("Invalid key length");
+        shared_lock<shared_mutex> lock(structure_mutex, defer_lock);
+        if (mode == TreeMode::Sparse)
+            lock.lock();
+
+        MerkleProof proof{key, {}, {}};
+        NodeType *node = root;
+        for (int level = 0; level < depth; ++level) {
+            int height = depth - level - 1;
+            NodeType *next = nullptr, *sibling = nullptr;
+            if (node) {
+                next = static_cast<NodeType *>(key.bit(level) ? node->right : node->left);
+                sibling = static_cast<NodeType *>(key.bit(level) ? node->left : node->right);
+            }
+            Digest hash;
+            if (readSibling(sibling, height, hash))
+                proof.siblings.push_back(hash);
+            else
+                proof.default_siblings.set(height);
+            node = next;
+        }
+        reverse(proof.siblings.begin(), proof.siblings.end());
+        return proof;
+    }
+
+    // Absence proof: stops descending at the first empty subtree on the key's
+    // path, so it carries only the non-default siblings above that. Throws if
+    // the key's leaf holds a non-default hash.
+    NonMembershipProof getNonMembershipProof(const BitKey &key) const {
+        if (key.size() != depth)
+            throw runtime_error("Invalid key length");
+        shared_lock<shared_mutex> lock(structure_mutex, defer_lock);
+        if (mode == TreeMode::Sparse)
+            lock.lock();
+
+        NonMembershipProof proof{key, 0, {}, {}};
+        NodeType *node = root;
+        int level = 0;
+        for (; node && readHash(node) != default_hashes[depth - level]; ++level) {
+            if (level == depth)
+                throw runtime_error("Key is present: " + key.toString());
+            int height = depth - level - 1;
+            NodeType *sibling = static_cast<NodeType *>(key.bit(level) ? node->left : node->right);
+            Digest hash;
+            if (readSibling(sibling, height, hash))
+                proof.siblings.push_back(hash);
+            else
+                proof.default_siblings.set(height);
+            node = static_cast<NodeType *>(key.bit(level) ? node->right : node->left);
+        }
+        proof.empty_height = depth - level;
+        reverse(proof.siblings.begin(), proof.siblings.end());
+        return proof;
+    }
+
+    // One proof for all the given keys (any order, repeats allowed), carrying
+    // each sibling shared between their paths once
+    MerkleMultiProof getMultiProof(vector<BitKey> keys) const {
+        for (const BitKey &key : keys)
+            if (key.size() != depth)
+                throw runtime_error("Invalid key length");
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+        MerkleMultiProof proof;
+        if (keys.empty())
+            return proof;
+
+        shared_lock<shared_mutex> lock(structure_mutex, defer_lock);
+        if (mode == TreeMode::Sparse)
+            lock.lock();
+
+        vector<vector<NodeType *>> needed(depth);
+        collectSiblings(root, 0, keys.data(), keys.data() + keys.size(), needed);
+        for (int height = 0; height < depth; ++height) {
+            for (NodeType *sibling : needed[height]) {
+                Digest hash;
+                bool present = readSibling(sibling, height, hash);
+                proof.default_siblings.push_back(!present);
+                if (present)
+                    proof.siblings.push_back(hash);
+            }
+        }
+        proof.keys = move(keys);
+        return proof;
+    }
+
+    // Lookup only; in sparse mode a key that was never written has no node
+    NodeType *getLeafNode(const BitKey &key) {
+        if (mode == TreeMode::Sparse) {
+            shared_lock<shared_mutex> lock(structure_mutex);
+            return findLeaf(key);
+        }
+        return findLeaf(key);
+    }
+
+    // Writers' lookup: in sparse mode, allocates the missing part of the path.
+    // New nodes start at their default hash, so no ancestor hash changes.
+    NodeType *getOrCreateLeafNode(const BitKey &key) {
+        NodeType *leaf = getLeafNode(key);
+        if (leaf || mode == TreeMode::Complete)
+            return leaf;
+        if (key.size() != depth)
             return nullptr;
-        return it->second;
+
+        unique_lock<shared_mutex> lock(structure_mutex);
+        if ((leaf = findLeaf(key)))
+            return leaf;
+
+        NodeType *node = root;
+        for (int i = 0; i < depth; ++i) {
+            auto &child = key.bit(i) ? node->right : node->left;
+            if (!child) {
+                NodeType *created = arena.create(i + 1 == depth);
+                created->parent = node;
+                created->hash = default_hashes[depth - i - 1];
+
+                lock_guard parent_lock(node->node_mutex);
+                child = created;
+            }
+            node = static_cast<NodeType *>(child);
+        }
+        leaf_nodes[key] = node;
+        return node;
     }
 
     void printLeafKeys() const {
         cout << "Leaf keys in the map: " << endl;
         for (const auto &pair : leaf_nodes) {
-            cout << "  " << pair.first << endl;
+            cout << "  " << pair.first.toString() << endl;
+        }
+        for (size_t i = 0; i < leaf_index.size(); ++i) {
+            cout << "  " << BitKey::fromIndex(i, depth).toString() << endl;
         }
     }
 };
 
 template <typename TreeType>
-void updateSerial(TreeType &tree, const string &key, const string &value) {
+void updateSerial(TreeType &tree, const BitKey &key, const string &value) {
     using Node = typename TreeType::NodeTypeAlias;
+    using Hash = typename TreeType::Hash;
 
     int depth = tree.getDepth();
-    if ((int)key.length() != depth) {
+    if (key.size() != depth) {
         throw runtime_error("Invalid key length");
     }
 
-    // Get leaf node
-    Node *current = static_cast<Node *>(tree.getLeafNode(key));
+    // Get leaf node (allocating its path in a sparse tree)
+    Node *current = static_cast<Node *>(tree.getOrCreateLeafNode(key));
     if (!current) {
-        throw runtime_error("Leaf node not found for key: " + key);
+        throw runtime_error("Leaf node not found for key: " + key.toString());
     }
 
     // Update leaf hash
     if (!current->is_leaf) {
         throw runtime_error("Reached non-leaf node while updating leaf");
     }
-    current->hash = computeHash(value);
+    current->hash = Hash::hashLeaf(value);
 
-    string childHash = current->hash;
+    Digest childHash = current->hash;
     Node *root = static_cast<Node *>(tree.getRoot());
 
-    // Percolate upwards
-    while (current != root) {
+    // Percolate upwards; a missing sibling is an empty subtree of our height
+    for (int height = 0; current != root; ++height) {
         Node *parent = static_cast<Node *>(current->parent);
         if (!parent)
             break;
@@ -157,13 +529,12 @@ void updateSerial(TreeType &tree, const string &key, const string &value) {
         Node *right = static_cast<Node *>(parent->right);
 
         bool isLeft = (current == left);
-        string siblingHash = isLeft ? right->hash : left->hash;
-
-        string parentHash = isLeft
-                                ? (childHash + siblingHash)
-                                : (siblingHash + childHash);
+        Node *sibling = isLeft ? right : left;
+        const Digest &siblingHash = sibling ? sibling->hash : tree.getDefaultHash(height);
 
-        parent->hash = computeHash(parentHash);
+        parent->hash = isLeft
+                           ? Hash::hashChildren(childHash, siblingHash)
+                           : Hash::hashChildren(siblingHash, childHash);
 
         current = parent;
         childHash = current->hash;
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  NodeArena: slab storage for tree nodes
+// ============================================================
+//
+// Nodes are placement-constructed into large anonymous mappings and are never
+// freed one at a time; the arena tears everything down at once when it is
+// destroyed. With huge pages requested, slabs of 2 MiB or more are advised as
+// transparent huge pages (Linux only; ignored elsewhere), which cuts TLB misses
+// on the percolation path of large trees.
+//
+// Not thread-safe: callers serialise create() (the tree does so through its
+// constructor and structure_mutex).
+
+template <typename T>
+class NodeArena {
+private:
+    static constexpr size_t MIN_SLAB_NODES = 1024;
+    static constexpr size_t MAX_SLAB_NODES = size_t(1) << 20;
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    struct Slab {
+        T *nodes;
+        size_t bytes;
+        size_t capacity;
+        size_t used;
+    };
+
+    vector<Slab> slabs;
+    bool huge_pages;
+    size_t next_slab_nodes;
+    size_t node_count;
+
+    void addSlab(size_t nodes) {
+        size_t bytes = nodes * sizeof(T);
+        void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throw bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (huge_pages && bytes >= HUGE_PAGE_SIZE)
+            madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+        slabs.push_back({static_cast<T *>(memory), bytes, nodes, 0});
+    }
+
+public:
+    explicit NodeArena(bool use_huge_pages = false)
+        : huge_pages(use_huge_pages), next_slab_nodes(MIN_SLAB_NODES), node_count(0) {}
+
+    NodeArena(const NodeArena &) = delete;
+    NodeArena &operator=(const NodeArena &) = delete;
+
+    ~NodeArena() {
+        release();
+    }
+
+    // Guarantees room for nodes more objects in the current slab, so a tree
+    // of known size is laid out in one contiguous mapping
+    void reserve(size_t nodes) {
+        if (slabs.empty() || slabs.back().capacity - slabs.back().used < nodes)
+            addSlab(nodes);
+    }
+
+    template <typename... Args>
+    T *create(Args &&...args) {
+        if (slabs.empty() || slabs.back().used == slabs.back().capacity) {
+            addSlab(next_slab_nodes);
+            if (next_slab_nodes < MAX_SLAB_NODES)
+                next_slab_nodes *= 2;
+        }
+        Slab &slab = slabs.back();
+        T *node = new (slab.nodes + slab.used) T(std::forward<Args>(args)...);
+        ++slab.used;
+        ++node_count;
+        return node;
+    }
+
+    // Contiguous storage for nodes objects, which the caller must all
+    // placement-construct before the arena is released. Lets a tree of known
+    // shape place each node at a computed slot, from several threads.
+    T *allocateBlock(size_t nodes) {
+        reserve(nodes);
+        Slab &slab = slabs.back();
+        T *block = slab.nodes + slab.used;
+        slab.used += nodes;
+        node_count += nodes;
+        return block;
+    }
+
+    size_t size() const {
+        return node_count;
+    }
+
+    // Destroys every node and unmaps all slabs
+    void release() {
+        for (Slab &slab : slabs) {
+            if (!is_trivially_destructible<T>::value)
+                for (size_t i = 0; i < slab.used; ++i)
+                    slab.nodes[i].~T();
+            munmap(slab.nodes, slab.bytes);
+        }
+        slabs.clear();
+        next_slab_nodes = MIN_SLAB_NODES;
+        node_count = 0;
+    }
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// ============================================================
+//  Node lock policies
+// ============================================================
+//
+// The lock embedded in every tree node, chosen per node type:
+//
+//   BasicMerkleNode<mutex>     futex-backed std::mutex (40 bytes)
+//   BasicMerkleNode<SpinLock>  1-byte test-and-test-and-set spinlock
+//   BasicMerkleNode<SeqLock>   4-byte sequence counter; writers exclude each
+//                              other, readers run optimistically and retry
+//
+// All three are BasicLockable, so lock_guard / unique_lock work unchanged.
+// Node critical sections are a few digest copies and at most one hash, short
+// enough that spinning beats parking a thread.
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Spin briefly, then give the core away: when threads outnumber cores the
+// holder may be preempted, and spinning through our time slice only delays it
+static constexpr int SPINS_BEFORE_YIELD = 64;
+
+static inline void spinWait(int &spins) {
+    if (++spins < SPINS_BEFORE_YIELD) {
+        cpuRelax();
+    } else {
+        spins = 0;
+        this_thread::yield();
+    }
+}
+
+struct SpinLock {
+    atomic<bool> locked{false};
+
+    void lock() {
+        int spins = 0;
+        while (locked.exchange(true, memory_order_acquire))
+            while (locked.load(memory_order_relaxed))
+                spinWait(spins);
+    }
+
+    bool try_lock() {
+        return !locked.load(memory_order_relaxed) && !locked.exchange(true, memory_order_acquire);
+    }
+
+    void unlock() {
+        locked.store(false, memory_order_release);
+    }
+};
+
+// Sequence is odd while a writer holds the lock. Readers call readBegin(),
+// copy what they need, and accept the copy only if readRetry() is false.
+struct SeqLock {
+    atomic<uint32_t> sequence{0};
+
+    void lock() {
+        int spins = 0;
+        uint32_t seq = sequence.load(memory_order_relaxed);
+        while (true) {
+            if (!(seq & 1) && sequence.compare_exchange_weak(seq, seq + 1, memory_order_acquire))
+                break;
+            spinWait(spins);
+            seq = sequence.load(memory_order_relaxed);
+        }
+        // Keep the protected stores from moving above the odd sequence
+        atomic_thread_fence(memory_order_release);
+    }
+
+    bool try_lock() {
+        uint32_t seq = sequence.load(memory_order_relaxed);
+        if ((seq & 1) || !sequence.compare_exchange_strong(seq, seq + 1, memory_order_acquire))
+            return false;
+        atomic_thread_fence(memory_order_release);
+        return true;
+    }
+
+    void unlock() {
+        sequence.fetch_add(1, memory_order_release);
+    }
+
+    // Waits out an active writer and returns the (even) sequence
+    uint32_t readBegin() const {
+        int spins = 0;
+        uint32_t seq;
+        while ((seq = sequence.load(memory_order_acquire)) & 1)
+            spinWait(spins);
+        return seq;
+    }
+
+    // True if a writer ran since readBegin returned seq
+    bool readRetry(uint32_t seq) const {
+        atomic_thread_fence(memory_order_acquire);
+        return sequence.load(memory_order_relaxed) != seq;
+    }
+};
+
+// Copy of a SeqLock-protected value taken without blocking writers: the copy
+// is retried until no write overlapped it. A torn copy may be made, but it is
+// never returned.
+template <typename T>
+T optimisticRead(const SeqLock &lock, const T &value) {
+    static_assert(is_trivially_copyable<T>::value, "optimisticRead copies raw bytes");
+    T copy;
+    uint32_t seq;
+    do {
+        seq = lock.readBegin();
+        memcpy(&copy, &value, sizeof(T));
+    } while (lock.readRetry(seq));
+    return copy;
+}
@@ -68,7 +68,7 @@ Result run_benchmark(
     vector<long long> angela_rt;
     angela_rt.reserve(total_ops);
 
-    vector<pair<string, string>> batch;
+    vector<pair<BitKey, string>> batch;
     vector<long long> batch_arr;
     batch.reserve(batch_size);
     batch_arr.reserve(batch_size);
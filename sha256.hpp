@@ -0,0 +1,256 @@
+#pragma once
+#include "digest.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <openssl/sha.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define MERKLE_HAVE_ARM_SHA2 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+#endif
+
+using namespace std;
+
+// ============================================================
+//  Interior-node hashing
+// ============================================================
+//
+// A parent hash is SHA-256 over exactly 64 bytes (left || right): one data
+// block followed by a padding block that is identical for every parent.
+// hashChildren() dispatches, once at startup, to the fastest single-message
+// backend the CPU offers: x86 SHA extensions, ARMv8 SHA2 instructions, or
+// OpenSSL's block function as the portable fallback.
+
+static constexpr uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+static constexpr uint32_t SHA256_IV[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+// Padding block of a 64-byte message: 0x80, zeros, bit length 512 (big endian)
+static const uint8_t SHA256_PAD_BLOCK_64[64] = {
+    0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x02, 0x00};
+
+// Expanded schedule (W[t] + K[t]) of SHA256_PAD_BLOCK_64, identical for every parent
+static constexpr array<uint32_t, 64> makeSha256PaddingSchedule() {
+    array<uint32_t, 64> w{};
+    w[0] = 0x80000000;
+    w[15] = 512;
+    for (int t = 16; t < 64; ++t) {
+        uint32_t x = w[t - 15], y = w[t - 2];
+        uint32_t s0 = ((x >> 7) | (x << 25)) ^ ((x >> 18) | (x << 14)) ^ (x >> 3);
+        uint32_t s1 = ((y >> 17) | (y << 15)) ^ ((y >> 19) | (y << 13)) ^ (y >> 10);
+        w[t] = s1 + w[t - 7] + s0 + w[t - 16];
+    }
+    for (int t = 0; t < 64; ++t)
+        w[t] += SHA256_K[t];
+    return w;
+}
+
+static constexpr array<uint32_t, 64> SHA256_PADDING_SCHEDULE = makeSha256PaddingSchedule();
+
+static inline uint32_t loadBigEndian32(const uint8_t *p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline void storeBigEndian32(uint8_t *p, uint32_t v) {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+// ------------------------------------------------------------
+//  Fallback: OpenSSL block function on a pre-initialised context
+// ------------------------------------------------------------
+
+// SHA256_Init/SHA256_Transform are deprecated in OpenSSL 3 but remain the only
+// public block-level entry points; EVP adds far more overhead than one block.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+static SHA256_CTX makeSha256InitialContext() {
+    SHA256_CTX ctx;
+    SHA256_Init(&ctx);
+    return ctx;
+}
+
+static const SHA256_CTX sha256InitialContext = makeSha256InitialContext();
+
+static Digest hashChildrenOpenSsl(const Digest &left, const Digest &right) {
+    SHA256_CTX ctx = sha256InitialContext;
+
+    uint8_t block[2 * Digest::SIZE];
+    memcpy(block, left.bytes, Digest::SIZE);
+    memcpy(block + Digest::SIZE, right.bytes, Digest::SIZE);
+
+    SHA256_Transform(&ctx, block);
+    SHA256_Transform(&ctx, SHA256_PAD_BLOCK_64);
+
+    Digest result;
+    for (int i = 0; i < 8; ++i)
+        storeBigEndian32(result.bytes + 4 * i, ctx.h[i]);
+    return result;
+}
+
+#pragma GCC diagnostic pop
+
+// ------------------------------------------------------------
+//  x86 SHA extensions (SHA-NI)
+// ------------------------------------------------------------
+#if defined(__x86_64__) || defined(__i386__)
+
+// Message words live in a 4-register ring; group g covers W[4g .. 4g+3]
+__attribute__((target("sha,sse4.1"))) static Digest hashChildrenShaNi(const Digest &left, const Digest &right) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // Hardware state layout is ABEF / CDGH
+    __m128i abef = _mm_set_epi32(SHA256_IV[0], SHA256_IV[1], SHA256_IV[4], SHA256_IV[5]);
+    __m128i cdgh = _mm_set_epi32(SHA256_IV[2], SHA256_IV[3], SHA256_IV[6], SHA256_IV[7]);
+    const __m128i abefInit = abef, cdghInit = cdgh;
+
+    __m128i msg[4];
+    msg[0] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left.bytes)), byteSwap);
+    msg[1] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left.bytes + 16)), byteSwap);
+    msg[2] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(right.bytes)), byteSwap);
+    msg[3] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(right.bytes + 16)), byteSwap);
+
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+        if (g >= 4) {
+            __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(msg[g & 3], msg[(g + 1) & 3]),
+                                         _mm_alignr_epi8(msg[(g + 3) & 3], msg[(g + 2) & 3], 4));
+            msg[g & 3] = _mm_sha256msg2_epu32(next, msg[(g + 3) & 3]);
+        }
+        __m128i wk = _mm_add_epi32(msg[g & 3], _mm_loadu_si128(reinterpret_cast<const __m128i *>(&SHA256_K[4 * g])));
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e));
+    }
+    abef = _mm_add_epi32(abef, abefInit);
+    cdgh = _mm_add_epi32(cdgh, cdghInit);
+
+    // Padding block: schedule already expanded, no message instructions
+    const __m128i abefMid = abef, cdghMid = cdgh;
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+        __m128i wk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&SHA256_PADDING_SCHEDULE[4 * g]));
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(wk, 0x0e));
+    }
+    abef = _mm_add_epi32(abef, abefMid);
+    cdgh = _mm_add_epi32(cdgh, cdghMid);
+
+    // Back to ABCD / EFGH, then big-endian bytes
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    __m128i abcd = _mm_blend_epi16(feba, dchg, 0xf0);
+    __m128i efgh = _mm_alignr_epi8(dchg, feba, 8);
+
+    Digest result;
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(result.bytes), _mm_shuffle_epi8(abcd, byteSwap));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(result.bytes + 16), _mm_shuffle_epi8(efgh, byteSwap));
+    return result;
+}
+
+#endif
+
+// ------------------------------------------------------------
+//  ARMv8 SHA2 instructions
+// ------------------------------------------------------------
+#if defined(MERKLE_HAVE_ARM_SHA2)
+
+static Digest hashChildrenArmSha2(const Digest &left, const Digest &right) {
+    uint32x4_t abcd = vld1q_u32(&SHA256_IV[0]);
+    uint32x4_t efgh = vld1q_u32(&SHA256_IV[4]);
+    const uint32x4_t abcdInit = abcd, efghInit = efgh;
+
+    uint32x4_t msg[4];
+    msg[0] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(left.bytes)));
+    msg[1] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(left.bytes + 16)));
+    msg[2] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(right.bytes)));
+    msg[3] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(right.bytes + 16)));
+
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+        uint32x4_t wk = vaddq_u32(msg[g & 3], vld1q_u32(&SHA256_K[4 * g]));
+        if (g < 12)
+            msg[g & 3] = vsha256su0q_u32(msg[g & 3], msg[(g + 1) & 3]);
+        uint32x4_t abcdPrev = abcd;
+        abcd = vsha256hq_u32(abcd, efgh, wk);
+        efgh = vsha256h2q_u32(efgh, abcdPrev, wk);
+        if (g < 12)
+            msg[g & 3] = vsha256su1q_u32(msg[g & 3], msg[(g + 2) & 3], msg[(g + 3) & 3]);
+    }
+    abcd = vaddq_u32(abcd, abcdInit);
+    efgh = vaddq_u32(efgh, efghInit);
+
+    const uint32x4_t abcdMid = abcd, efghMid = efgh;
+#pragma GCC unroll 16
+    for (int g = 0; g < 16; ++g) {
+        uint32x4_t wk = vld1q_u32(&SHA256_PADDING_SCHEDULE[4 * g]);
+        uint32x4_t abcdPrev = abcd;
+        abcd = vsha256hq_u32(abcd, efgh, wk);
+        efgh = vsha256h2q_u32(efgh, abcdPrev, wk);
+    }
+    abcd = vaddq_u32(abcd, abcdMid);
+    efgh = vaddq_u32(efgh, efghMid);
+
+    Digest result;
+    vst1q_u8(result.bytes, vrev32q_u8(vreinterpretq_u8_u32(abcd)));
+    vst1q_u8(result.bytes + 16, vrev32q_u8(vreinterpretq_u8_u32(efgh)));
+    return result;
+}
+
+#endif
+
+// ------------------------------------------------------------
+//  Runtime selection
+// ------------------------------------------------------------
+
+struct Sha256Backend {
+    const char *name;
+    Digest (*hashChildren)(const Digest &left, const Digest &right);
+};
+
+static Sha256Backend selectSha256Backend() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+        return {"sha-ni", hashChildrenShaNi};
+#endif
+#if defined(MERKLE_HAVE_ARM_SHA2)
+#if defined(__linux__)
+    if (getauxval(AT_HWCAP) & HWCAP_SHA2)
+        return {"armv8-sha2", hashChildrenArmSha2};
+#else
+    return {"armv8-sha2", hashChildrenArmSha2};
+#endif
+#endif
+    return {"openssl", hashChildrenOpenSsl};
+}
+
+static const Sha256Backend sha256Backend = selectSha256Backend();
+
+// Parent hash: SHA-256(left || right)
+Digest hashChildren(const Digest &left, const Digest &right) {
+    return sha256Backend.hashChildren(left, right);
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "sha256.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// ============================================================
+//  Multi-buffer SHA-256 for independent parent hashes
+// ============================================================
+//
+// Every job is one parent: out = SHA-256(*left || *right). A kernel hashes
+// LANES jobs at once with one SHA-256 message per 32-bit vector lane. The
+// lane code is written with GCC vector extensions and compiled once per
+// instruction set through target attributes, so no global -m flags are
+// needed; the widest kernel the CPU supports is picked once at startup.
+// Narrow kernels are skipped when the single-message backend has hardware
+// SHA instructions, since looping over those is faster.
+
+struct HashChildrenJob {
+    const Digest *left;
+    const Digest *right;
+    Digest *out;
+};
+
+#define SHA256_LANES_INLINE __attribute__((always_inline)) static inline
+
+// Macro rather than a function so vector values never cross a call boundary
+#define rotrLanes(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// One round; wk is W[t] + K[t] for every lane
+template <typename V>
+SHA256_LANES_INLINE void sha256RoundLanes(V s[8], const V &wk) {
+    V t1 = s[7] + (rotrLanes(s[4], 6) ^ rotrLanes(s[4], 11) ^ rotrLanes(s[4], 25)) +
+           ((s[4] & s[5]) ^ (~s[4] & s[6])) + wk;
+    V t2 = (rotrLanes(s[0], 2) ^ rotrLanes(s[0], 13) ^ rotrLanes(s[0], 22)) +
+           ((s[0] & s[1]) ^ (s[0] & s[2]) ^ (s[1] & s[2]));
+    s[7] = s[6];
+    s[6] = s[5];
+    s[5] = s[4];
+    s[4] = s[3] + t1;
+    s[3] = s[2];
+    s[2] = s[1];
+    s[1] = s[0];
+    s[0] = t1 + t2;
+}
+
+template <typename V, int LANES>
+SHA256_LANES_INLINE void hashChildrenLanes(const HashChildrenJob *jobs) {
+    // Transpose: w[i] holds message word i of every lane
+    V w[16];
+    for (int lane = 0; lane < LANES; ++lane) {
+        for (int i = 0; i < 8; ++i) {
+            w[i][lane] = loadBigEndian32(jobs[lane].left->bytes + 4 * i);
+            w[i + 8][lane] = loadBigEndian32(jobs[lane].right->bytes + 4 * i);
+        }
+    }
+
+    V state[8], s[8];
+    for (int i = 0; i < 8; ++i)
+        state[i] = s[i] = V{} + SHA256_IV[i];
+
+    // Data block, message schedule expanded in a rolling 16-word window
+    for (int t = 0; t < 64; ++t) {
+        if (t >= 16) {
+            V x = w[(t - 15) & 15], y = w[(t - 2) & 15];
+            w[t & 15] += (rotrLanes(y, 17) ^ rotrLanes(y, 19) ^ (y >> 10)) + w[(t - 7) & 15] +
+                         (rotrLanes(x, 7) ^ rotrLanes(x, 18) ^ (x >> 3));
+        }
+        sha256RoundLanes(s, w[t & 15] + SHA256_K[t]);
+    }
+    for (int i = 0; i < 8; ++i)
+        state[i] = s[i] = state[i] + s[i];
+
+    // Padding block, schedule is a compile-time constant
+    for (int t = 0; t < 64; ++t)
+        sha256RoundLanes(s, V{} + SHA256_PADDING_SCHEDULE[t]);
+
+    for (int i = 0; i < 8; ++i) {
+        V h = state[i] + s[i];
+        for (int lane = 0; lane < LANES; ++lane)
+            storeBigEndian32(jobs[lane].out->bytes + 4 * i, h[lane]);
+    }
+}
+
+#undef rotrLanes
+#undef SHA256_LANES_INLINE
+
+static void hashChildrenScalar(const HashChildrenJob *jobs) {
+    *jobs->out = hashChildren(*jobs->left, *jobs->right);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+typedef uint32_t Sha256LanesX4 __attribute__((vector_size(16)));
+typedef uint32_t Sha256LanesX8 __attribute__((vector_size(32)));
+typedef uint32_t Sha256LanesX16 __attribute__((vector_size(64)));
+
+__attribute__((target("sse4.1"))) static void hashChildrenSse4(const HashChildrenJob *jobs) {
+    hashChildrenLanes<Sha256LanesX4, 4>(jobs);
+}
+
+__attribute__((target("avx2"))) static void hashChildrenAvx2(const HashChildrenJob *jobs) {
+    hashChildrenLanes<Sha256LanesX8, 8>(jobs);
+}
+
+__attribute__((target("avx512f"))) static void hashChildrenAvx512(const HashChildrenJob *jobs) {
+    hashChildrenLanes<Sha256LanesX16, 16>(jobs);
+}
+#endif
+
+struct Sha256BatchKernel {
+    const char *name;
+    size_t lanes;
+    void (*hash)(const HashChildrenJob *jobs);
+};
+
+static Sha256BatchKernel selectSha256BatchKernel() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return {"avx512", 16, hashChildrenAvx512};
+    // A single-lane SHA-NI loop outruns the 4- and 8-lane software kernels
+    bool hardwareSingleLane = sha256Backend.hashChildren != hashChildrenOpenSsl;
+    if (__builtin_cpu_supports("avx2") && !hardwareSingleLane)
+        return {"avx2", 8, hashChildrenAvx2};
+    if (__builtin_cpu_supports("sse4.1") && !hardwareSingleLane)
+        return {"sse4", 4, hashChildrenSse4};
+#endif
+    return {"scalar", 1, hashChildrenScalar};
+}
+
+static const Sha256BatchKernel sha256BatchKernel = selectSha256BatchKernel();
+
+// Number of jobs the selected kernel hashes per call
+size_t hashChildrenBatchWidth() {
+    return sha256BatchKernel.lanes;
+}
+
+// Hash n independent parents; the tail that does not fill a kernel runs scalar
+void hashChildrenBatch(const HashChildrenJob *jobs, size_t n) {
+    const Sha256BatchKernel &kernel = sha256BatchKernel;
+    size_t i = 0;
+    if (kernel.lanes > 1) {
+        for (; i + kernel.lanes <= n; i += kernel.lanes)
+            kernel.hash(jobs + i);
+    }
+    for (; i < n; ++i)
+        hashChildrenScalar(jobs + i);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "digest.hpp"
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// ============================================================
+//  SHA-512/256
+// ============================================================
+//
+// SHA-512 with its own IV, truncated to 32 bytes. A 64-byte parent message
+// and its padding fit in a single 128-byte block, so a parent costs exactly
+// one compression (SHA-256 needs two).
+
+static constexpr uint64_t SHA512_K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+static constexpr uint64_t SHA512_256_IV[8] = {
+    0x22312194fc2bf72cULL, 0x9f555fa3c84c64c2ULL, 0x2393b86b6f53b151ULL, 0x963877195940eabdULL,
+    0x96283ee2a88effe3ULL, 0xbe5e1e2553863992ULL, 0x2b0199fc2c85b8aaULL, 0x0eb72ddc81c52ca2ULL};
+
+static inline uint64_t rotr64(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+static inline uint64_t loadBigEndian64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_bswap64(v);
+}
+
+static inline void storeBigEndian64(uint8_t *p, uint64_t v) {
+    for (int i = 7; i >= 0; --i) {
+        p[i] = uint8_t(v);
+        v >>= 8;
+    }
+}
+
+static void sha512Compress(uint64_t state[8], const uint8_t block[128]) {
+    uint64_t w[80];
+    for (int t = 0; t < 16; ++t)
+        w[t] = loadBigEndian64(block + 8 * t);
+    for (int t = 16; t < 80; ++t) {
+        uint64_t s0 = rotr64(w[t - 15], 1) ^ rotr64(w[t - 15], 8) ^ (w[t - 15] >> 7);
+        uint64_t s1 = rotr64(w[t - 2], 19) ^ rotr64(w[t - 2], 61) ^ (w[t - 2] >> 6);
+        w[t] = s1 + w[t - 7] + s0 + w[t - 16];
+    }
+
+    uint64_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint64_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int t = 0; t < 80; ++t) {
+        uint64_t t1 = h + (rotr64(e, 14) ^ rotr64(e, 18) ^ rotr64(e, 41)) + ((e & f) ^ (~e & g)) + SHA512_K[t] + w[t];
+        uint64_t t2 = (rotr64(a, 28) ^ rotr64(a, 34) ^ rotr64(a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+static Digest sha512_256Finish(const uint64_t state[8]) {
+    Digest result;
+    for (int i = 0; i < 4; ++i)
+        storeBigEndian64(result.bytes + 8 * i, state[i]);
+    return result;
+}
+
+Digest sha512_256Hash(const uint8_t *data, size_t length) {
+    uint64_t state[8];
+    memcpy(state, SHA512_256_IV, sizeof(state));
+
+    size_t full = length / 128;
+    for (size_t i = 0; i < full; ++i)
+        sha512Compress(state, data + 128 * i);
+
+    // Tail, 0x80 terminator and 128-bit big-endian bit length
+    uint8_t block[256] = {};
+    size_t rest = length - 128 * full;
+    memcpy(block, data + 128 * full, rest);
+    block[rest] = 0x80;
+    size_t blocks = (rest + 1 + 16 <= 128) ? 1 : 2;
+    storeBigEndian64(block + 128 * blocks - 8, uint64_t(length) << 3);
+    storeBigEndian64(block + 128 * blocks - 16, uint64_t(length) >> 61);
+    for (size_t i = 0; i < blocks; ++i)
+        sha512Compress(state, block + 128 * i);
+
+    return sha512_256Finish(state);
+}
+
+Digest sha512_256HashChildren(const Digest &left, const Digest &right) {
+    uint64_t state[8];
+    memcpy(state, SHA512_256_IV, sizeof(state));
+
+    uint8_t block[128] = {};
+    memcpy(block, left.bytes, Digest::SIZE);
+    memcpy(block + Digest::SIZE, right.bytes, Digest::SIZE);
+    block[2 * Digest::SIZE] = 0x80;
+    storeBigEndian64(block + 120, 512);
+    sha512Compress(state, block);
+
+    return sha512_256Finish(state);
+}
@@ -0,0 +1,322 @@
+#pragma once
+#include "bitKey.hpp"
+#include "epoch.hpp"
+#include "hashPolicy.hpp"
+#include "merkleProof.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  VersionedMerkleTree: persistent tree with MVCC snapshots
+// ============================================================
+//
+// Nodes are immutable once published. A commit applies a batch of updates by
+// copying the nodes on the updated paths (each hashed once) and sharing every
+// untouched subtree, then publishes the new root as the next version with one
+// atomic store. Readers pin a version through a Snapshot and see it
+// unchanged, with no locks, however many commits follow.
+//
+// The most recent `history` versions stay readable; a version costs only the
+// nodes its commit copied. Nodes are reference counted by their parents and
+// by version roots. A version that falls out of the history is unlinked and
+// retired to the epoch manager, and once no snapshot can still hold it its
+// root reference is dropped, freeing every node no other version shares.
+//
+// A null child is an empty subtree (hash from the per-height default table),
+// so any depth up to BitKey::MAX_BITS works and only written paths exist.
+
+struct VersionNode {
+    Digest hash;
+    const VersionNode *left;
+    const VersionNode *right;
+    mutable uint32_t refs; // parents and version roots; writer only
+};
+
+template <typename HashPolicy = Sha256Hash>
+class VersionedMerkleTree {
+public:
+    using Hash = HashPolicy;
+    using Entry = pair<BitKey, string>;
+
+    // Keep every version until pruneHistory is called
+    static constexpr size_t KEEP_ALL_VERSIONS = SIZE_MAX;
+
+    // What a commit publishes. Retained versions form a list from the newest
+    // back; older is cut (set to null) when the older version is pruned.
+    struct Version {
+        uint64_t number;
+        const VersionNode *root; // nullptr: empty tree
+        atomic<const Version *> older;
+    };
+
+    // A pinned version; cheap to create, must not outlive the tree
+    class Snapshot {
+    private:
+        const VersionedMerkleTree *tree;
+        int slot;
+        const Version *pinned;
+
+    public:
+        explicit Snapshot(const VersionedMerkleTree &owner)
+            : tree(&owner), slot(owner.epochs.enter()), pinned(owner.current.load()) {}
+
+        // A retained older version, found by walking back from the newest
+        Snapshot(const VersionedMerkleTree &owner, uint64_t number)
+            : tree(&owner), slot(owner.epochs.enter()), pinned(owner.current.load()) {
+            while (pinned && pinned->number > number)
+                pinned = pinned->older.load();
+            if (!pinned || pinned->number != number) {
+                owner.epochs.exit(slot);
+                throw out_of_range("Version " + to_string(number) + " is not retained");
+            }
+        }
+
+        Snapshot(Snapshot &&other) noexcept
+            : tree(other.tree), slot(other.slot), pinned(other.pinned) {
+            other.slot = -1;
+        }
+
+        Snapshot(const Snapshot &) = delete;
+        Snapshot &operator=(const Snapshot &) = delete;
+        Snapshot &operator=(Snapshot &&) = delete;
+
+        ~Snapshot() {
+            if (slot >= 0)
+                tree->epochs.exit(slot);
+        }
+
+        uint64_t version() const {
+            return pinned->number;
+        }
+
+        const Digest &rootHash() const {
+            return tree->hashOf(pinned->root, tree->depth);
+        }
+
+        string getRootHash() const {
+            return rootHash().toHex();
+        }
+
+        const Digest &leafHash(const BitKey &key) const {
+            if (key.size() != tree->depth)
+                throw runtime_error("Invalid key length");
+            const VersionNode *node = pinned->root;
+            for (int level = 0; node && level < tree->depth; ++level)
+                node = key.bit(level) ? node->right : node->left;
+            return tree->hashOf(node, 0);
+        }
+
+        // Inclusion proof against rootHash(); a key never written in this
+        // version is proven to hold the default leaf hash. Siblings equal to
+        // the empty-subtree hash (null children included) are sent as
+        // defaults, as SparseMerkleTree::getProof does.
+        MerkleProof getProof(const BitKey &key) const {
+            if (key.size() != tree->depth)
+                throw runtime_error("Invalid key length");
+            MerkleProof proof{key, {}, {}};
+            const VersionNode *node = pinned->root;
+            for (int level = 0; level < tree->depth; ++level) {
+                int height = tree->depth - level - 1;
+                const VersionNode *sibling = nullptr;
+                if (node) {
+                    sibling = key.bit(level) ? node->left : node->right;
+                    node = key.bit(level) ? node->right : node->left;
+                }
+                addSibling(proof, sibling, height);
+            }
+            reverse(proof.siblings.begin(), proof.siblings.end());
+            return proof;
+        }
+
+        // Absence proof against rootHash(), stopping at the first empty
+        // subtree on the key's path; throws if the key holds a value
+        NonMembershipProof getNonMembershipProof(const BitKey &key) const {
+            if (key.size() != tree->depth)
+                throw runtime_error("Invalid key length");
+            NonMembershipProof proof{key, 0, {}, {}};
+            const VersionNode *node = pinned->root;
+            int level = 0;
+            for (; node && node->hash != tree->default_hashes[tree->depth - level]; ++level) {
+                if (level == tree->depth)
+                    throw runtime_error("Key is present: " + key.toString());
+                addSibling(proof, key.bit(level) ? node->left : node->right, tree->depth - level - 1);
+                node = key.bit(level) ? node->right : node->left;
+            }
+            proof.empty_height = tree->depth - level;
+            reverse(proof.siblings.begin(), proof.siblings.end());
+            return proof;
+        }
+
+    private:
+        template <typename Proof>
+        void addSibling(Proof &proof, const VersionNode *sibling, int height) const {
+            const Digest &hash = tree->hashOf(sibling, height);
+            if (hash == tree->default_hashes[height])
+                proof.default_siblings.set(height);
+            else
+                proof.siblings.push_back(hash);
+        }
+    };
+
+private:
+    int depth;
+    vector<Digest> default_hashes;
+    atomic<const Version *> current;
+    mutable EpochManager epochs;
+    mutex writer_mutex;
+    size_t history;
+    deque<Version *> retained; // oldest first; writer only
+
+    const Digest &hashOf(const VersionNode *node, int height) const {
+        return node ? node->hash : default_hashes[height];
+    }
+
+    static const VersionNode *acquire(const VersionNode *node) {
+        if (node)
+            ++node->refs;
+        return node;
+    }
+
+    static void release(const VersionNode *node) {
+        if (!node || --node->refs > 0)
+            return;
+        release(node->left);
+        release(node->right);
+        delete node;
+    }
+
+    // Deferred by the epoch manager until no snapshot can reach the version
+    static void destroyVersion(void *p) {
+        Version *version = static_cast<Version *>(p);
+        release(version->root);
+        delete version;
+    }
+
+    // Copies the part of node's subtree (at level) covered by the sorted,
+    // distinct updates [begin, end); everything else is shared
+    const VersionNode *apply(const VersionNode *node, int level, const Entry *begin, const Entry *end) {
+        if (begin == end)
+            return node;
+
+        VersionNode *fresh = new VersionNode{Digest(), nullptr, nullptr, 0};
+        if (level == depth) {
+            fresh->hash = HashPolicy::hashLeaf(begin->second);
+            return fresh;
+        }
+
+        // Keys in the range share this node's path, so they split on one bit
+        const Entry *mid = partition_point(begin, end, [level](const Entry &e) { return !e.first.bit(level); });
+        fresh->left = acquire(apply(node ? node->left : nullptr, level + 1, begin, mid));
+        fresh->right = acquire(apply(node ? node->right : nullptr, level + 1, mid, end));
+
+        int childHeight = depth - level - 1;
+        fresh->hash = HashPolicy::hashChildren(hashOf(fresh->left, childHeight), hashOf(fresh->right, childHeight));
+        return fresh;
+    }
+
+    // Unlinks the oldest retained version; readers already on it keep it
+    // alive until they leave their epoch
+    void pruneOldest() {
+        Version *oldest = retained.front();
+        retained.pop_front();
+        retained.front()->older.store(nullptr);
+        epochs.retire(oldest, destroyVersion);
+    }
+
+public:
+    // history: how many of the most recent versions stay readable (at least 1)
+    VersionedMerkleTree(int tree_depth, size_t history_versions = 1)
+        : depth(tree_depth), history(max<size_t>(history_versions, 1)) {
+        default_hashes = defaultHashes<HashPolicy>(tree_depth, BitKey::MAX_BITS);
+
+        retained.push_back(new Version{0, nullptr, {nullptr}});
+        current.store(retained.back());
+    }
+
+    VersionedMerkleTree(const VersionedMerkleTree &) = delete;
+    VersionedMerkleTree &operator=(const VersionedMerkleTree &) = delete;
+
+    // Retained versions are released here, retired ones by the epoch manager
+    ~VersionedMerkleTree() {
+        for (Version *version : retained)
+            destroyVersion(version);
+    }
+
+    int getDepth() const {
+        return depth;
+    }
+
+    const Digest &getDefaultHash(int height) const {
+        return default_hashes[height];
+    }
+
+    // Applies a batch atomically and returns the new version number; for a
+    // repeated key the last value wins. Commits are serialised, reads are not.
+    uint64_t commit(vector<Entry> updates) {
+        for (const Entry &entry : updates)
+            if (entry.first.size() != depth)
+                throw runtime_error("Invalid key length");
+        coalesceByKey(updates);
+
+        lock_guard<mutex> lock(writer_mutex);
+        Version *previous = retained.back();
+        uint64_t number = previous->number + 1;
+        const VersionNode *root = acquire(apply(previous->root, 0, updates.data(), updates.data() + updates.size()));
+
+        retained.push_back(new Version{number, root, {previous}});
+        current.store(retained.back());
+
+        while (retained.size() > history)
+            pruneOldest();
+        epochs.advanceAndReclaim();
+        return number;
+    }
+
+    // Drops all but the newest keep versions (at least one is kept)
+    void pruneHistory(size_t keep) {
+        lock_guard<mutex> lock(writer_mutex);
+        while (retained.size() > max<size_t>(keep, 1))
+            pruneOldest();
+        epochs.advanceAndReclaim();
+    }
+
+    uint64_t update(const BitKey &key, const string &value) {
+        return commit({{key, value}});
+    }
+
+    // Pins the latest committed version
+    Snapshot snapshot() const {
+        return Snapshot(*this);
+    }
+
+    // Pins a retained past version; throws out_of_range if it was pruned
+    Snapshot snapshot(uint64_t version) const {
+        return Snapshot(*this, version);
+    }
+
+    uint64_t getVersion() const {
+        return snapshot().version();
+    }
+
+    string getRootHash() const {
+        return snapshot().getRootHash();
+    }
+
+    // Oldest version still readable; only the writer thread may call this
+    uint64_t getOldestVersion() const {
+        return retained.front()->number;
+    }
+
+    // Pruned versions not yet freed
+    size_t pendingReclaimCount() const {
+        return epochs.pendingCount();
+    }
+};
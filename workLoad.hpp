@@ -9,27 +9,32 @@ enum OperationType { UPDATE,
 // Struct for operation requests (update or read)
 struct OperationRequest {
     OperationType op_type;
-    string key;   // For update or read_leaf
+    BitKey key;   // For update or read_leaf
     string value; // For update
 
-    OperationRequest(OperationType t, const string &k = "", const string &v = "")
+    OperationRequest(OperationType t, const BitKey &k = BitKey(), const string &v = "")
         : op_type(t), key(k), value(v) {}
 };
 
+// Uniformly random leaf key of a tree of the given depth
+BitKey generate_random_key(int tree_depth) {
+    BitKey key(tree_depth);
+    for (int i = 0; i < tree_depth; ++i)
+        key.setBit(i, rand() % 2);
+    return key;
+}
+
 // Random operation generator
-OperationRequest generate_random_operation(int tree_depth, double read_percentage, const vector<string> &leaf_keys) {
+OperationRequest generate_random_operation(int tree_depth, double read_percentage) {
     double p = (rand() % 10000) / 100.0;
     if (p < read_percentage) {
         if (rand() % 2) {
             return OperationRequest(READ_ROOT);
         } else {
-            string random_leaf = leaf_keys[rand() % leaf_keys.size()];
-            return OperationRequest(READ_LEAF, random_leaf);
+            return OperationRequest(READ_LEAF, generate_random_key(tree_depth));
         }
     } else {
-        string key;
-        for (int i = 0; i < tree_depth; ++i)
-            key += (rand() % 2) ? '1' : '0';
+        BitKey key = generate_random_key(tree_depth);
         string value = to_string(rand() % 1000);
         return OperationRequest(UPDATE, key, value);
     }
@@ -54,17 +59,6 @@ vector<WorkloadEvent> generate_workload(
     vector<WorkloadEvent> stream;
     stream.reserve(total_ops);
 
-    // ----------------------------------------------------------
-    // Generate full list of leaf keys (fixed for any depth)
-    // ----------------------------------------------------------
-    vector<string> leaf_keys;
-    leaf_keys.reserve(1 << depth);
-
-    for (int i = 0; i < (1 << depth); ++i) {
-        string k = bitset<32>(i).to_string().substr(32 - depth);
-        leaf_keys.push_back(k);
-    }
-
     // ----------------------------------------------------------
     // RNG for inter-arrival time
     // ----------------------------------------------------------
@@ -78,7 +72,7 @@ vector<WorkloadEvent> generate_workload(
     for (int i = 0; i < total_ops; i++) {
 
         OperationRequest op =
-            generate_random_operation(depth, read_percent, leaf_keys);
+            generate_random_operation(depth, read_percent);
 
         long long arrival_us = now_us() - workload_start;
         stream.emplace_back(op, arrival_us);
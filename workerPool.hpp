@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// ============================================================
+//  WorkerPool: long-lived threads for per-batch parallel work
+// ============================================================
+//
+// Threads are started once and parked between batches. run() wakes them for
+// one job and returns when every participant has finished it, so a batch
+// costs a wake-up and a barrier instead of creating and joining threads. The
+// calling thread takes part as worker 0.
+//
+// run() is not reentrant: one thread at a time drives the pool.
+
+class WorkerPool {
+private:
+    vector<thread> workers;
+    mutex pool_mutex;
+    condition_variable wake;
+    condition_variable done;
+    uint64_t generation = 0; // bumped once per run()
+    bool stopping = false;
+    const function<void(int)> *job = nullptr;
+    int participants = 0;
+    int pending = 0; // pool threads still inside the current job
+
+    void workerLoop(int tid) {
+        uint64_t seen = 0;
+        while (true) {
+            const function<void(int)> *task;
+            {
+                unique_lock<mutex> lock(pool_mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                if (tid >= participants)
+                    continue;
+                task = job;
+            }
+
+            (*task)(tid);
+
+            lock_guard<mutex> lock(pool_mutex);
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+
+    void waitForWorkers() {
+        unique_lock<mutex> lock(pool_mutex);
+        done.wait(lock, [&] { return pending == 0; });
+    }
+
+public:
+    // threads counts the caller, so threads - 1 pool threads are started
+    explicit WorkerPool(int threads) {
+        for (int tid = 1; tid < threads; ++tid)
+            workers.emplace_back(&WorkerPool::workerLoop, this, tid);
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(pool_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    int size() const {
+        return int(workers.size()) + 1;
+    }
+
+    // Calls fn(tid) for tid in [0, threads) in parallel and waits for all of
+    // them; threads is capped at size()
+    void run(int threads, const function<void(int)> &fn) {
+        threads = max(1, min(threads, size()));
+        if (threads > 1) {
+            {
+                lock_guard<mutex> lock(pool_mutex);
+                job = &fn;
+                participants = threads;
+                pending = threads - 1;
+                ++generation;
+            }
+            wake.notify_all();
+        }
+
+        // Workers hold a pointer to fn, so even if our share throws, wait for
+        // theirs before fn can go out of scope
+        try {
+            fn(0);
+        } catch (...) {
+            waitForWorkers();
+            throw;
+        }
+        waitForWorkers();
+    }
+};
+
+// ============================================================
+//  LazyWorkerPool: a caller's pool, or one of our own
+// ============================================================
+//
+// For algorithms that accept a shared pool but also work without one: with
+// no executor given, a private pool is started on first use and regrown (by
+// replacement) when a batch asks for more threads than it has.
+
+class LazyWorkerPool {
+private:
+    unique_ptr<WorkerPool> owned;
+    WorkerPool *shared = nullptr;
+
+public:
+    LazyWorkerPool() = default;
+    explicit LazyWorkerPool(WorkerPool &executor) : shared(&executor) {}
+
+    WorkerPool &get(int threads) {
+        if (shared)
+            return *shared;
+        if (!owned || owned->size() < threads)
+            owned = make_unique<WorkerPool>(threads);
+        return *owned;
+    }
+};
+
+// Fewest items per thread worth waking pool threads for
+static constexpr size_t MIN_RANGE_PER_THREAD = 64;
+
+// Runs fn(begin, end) over [0, n) in one contiguous range per thread, on at
+// most threads threads of pool, and returns once every range is done. With
+// no pool, or too little work to split, the calling thread does it all.
+template <typename Fn>
+void parallelRanges(WorkerPool *pool, int threads, size_t n, Fn fn) {
+    size_t ranges = min<size_t>(threads, n / MIN_RANGE_PER_THREAD);
+    if (pool)
+        ranges = min<size_t>(ranges, pool->size());
+    if (!pool || ranges <= 1) {
+        fn(size_t(0), n);
+        return;
+    }
+    pool->run(int(ranges), [&](int tid) {
+        fn(n * tid / ranges, n * (tid + 1) / ranges);
+    });
+}